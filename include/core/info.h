@@ -53,18 +53,18 @@ struct AccessBlockInfo {
     class Access {
     public:
         enum class Type : byte {
-            check_only = 0, writable = 1, read_only = 2, int_additive = 3,
+            check_only = 0, writable = 1, read_only = 2, int_additive = 3, float_additive = 4,
         };
 
         enum class Operation : byte {
-            check, int_add, read, write
+            check, int_add, read, write, float_add
         };
 
         Access(Type type) : type(type) {} // NOLINT(google-explicit-constructor)
 
         [[nodiscard]]
         bool isAdditive() const {
-            return type == Type::int_additive;
+            return type == Type::int_additive || type == Type::float_additive;
         }
 
         bool operator==(Access other) const {
@@ -89,6 +89,8 @@ struct AccessBlockInfo {
                     return op != Operation::check;
                 case Type::int_additive:
                     return !(op == Operation::check || op == Operation::int_add);
+                case Type::float_additive:
+                    return !(op == Operation::check || op == Operation::float_add);
                 case Type::read_only:
                     return !(op == Operation::check || op == Operation::read);
                 case Type::writable:
@@ -104,6 +106,7 @@ struct AccessBlockInfo {
                 case Type::check_only:
                     return false;
                 case Type::int_additive:
+                case Type::float_additive:
                     return !(other.type == Type::check_only);
                 case Type::read_only:
                     return !(other.type == Type::check_only || other.type == Type::read_only);
@@ -205,8 +208,8 @@ struct AppRequestInfo {
      * satisfied if the request identifiers have been chosen based on a topological order of the execution dag.
      */
     // The adjList should be checked to make sure all ids are in the range (id, numOfRequests). In other words all
-    // adjacent nodes should have a greater id.
-    std::unordered_set<AppRequestIdType> adjList;
+    // adjacent nodes should have a greater id. Duplicate ids are ignored.
+    std::vector<AppRequestIdType> adjList;
 
     /**
      *  attachments is a list of requests of the current block that are "attached" to this request. That means, for
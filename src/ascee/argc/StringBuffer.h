@@ -23,6 +23,7 @@
 #include "core/primitives.h"
 #include <string>
 #include <stdexcept>
+#include <charconv>
 #include <climits>
 #include "util/StaticArray.hpp"
 
@@ -134,11 +135,13 @@ public:
     }
 
     StringBuffer& operator<<(const LongID& v) {
-        return append(std::string(v));
+        char digits[18];
+        return append(StringView(digits, util::toHex(v, digits)));
     }
 
     StringBuffer& operator<<(uint64_t v) {
-        return append(std::to_string(v));
+        char digits[20];
+        return append(StringView(digits, std::to_chars(digits, digits + sizeof(digits), v).ptr - digits));
     }
 
     [[nodiscard]] int size() const { return end; }
@@ -88,6 +88,8 @@ void store_int64(int32 offset, int64 value);
 
 void add_int64_to(int32 offset, int64 amount);
 
+void add_float64_to(int32 offset, float64 amount);
+
 void resize_chunk(int32 new_size);
 
 string_view_c scan_int64(string_view_c input, string_view_c pattern, int64& output);
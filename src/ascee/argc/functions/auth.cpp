@@ -133,25 +133,24 @@ int16 argc::virtual_sign(long_id issuer_account, message_c& msg) {
 
     heap.loadChunk(issuer_account, nonce_chunk_local_id_g);
     if (!heap.isValid(0, nonce16_size_g)) {
-        throw Executor::Error((string) issuer_account + " is not valid",
-                              StatusCode::internal_error, "virtual_sign");
+        throw Executor::Error(StatusCode::internal_error, {issuer_account, " is not valid"}, "virtual_sign");
     }
 
     auto decisionNonce = heap.load<uint16>(0);
 
     // decisionNonce == 0 means that the owner of the account is an app
     if (decisionNonce != 0) {
-        throw Executor::Error((std::string) issuer_account + " does not belong to an app",
-                              StatusCode::internal_error, "virtual_sign");
+        throw Executor::Error(StatusCode::internal_error, {issuer_account, " does not belong to an app"},
+                              "virtual_sign");
     }
 
     long_id owner = heap.loadIdentifier(app_trie_g, decision_nonce_size_g + arg_balance_size_g, 0);
     if (signer != owner) {
-        throw Executor::Error((string) owner + " is not owner of:" + (string) issuer_account,
-                              StatusCode::internal_error, "virtual_sign");
+        throw Executor::Error(StatusCode::internal_error, {owner, " is not owner of:", issuer_account},
+                              "virtual_sign");
     }
 
-    int16 ret = (int16) Executor::getSession()->sigManager.sign(string(msg), issuer_account);
+    int16 ret = (int16) Executor::getSession()->sigManager.sign(std::string_view(msg), issuer_account);
 
     Executor::unGuard();
     return ret;
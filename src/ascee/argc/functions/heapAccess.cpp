@@ -75,6 +75,12 @@ void argc::add_int64_to(int32 offset, int64 amount) {
     Executor::unGuard();
 }
 
+void argc::add_float64_to(int32 offset, float64 amount) {
+    Executor::guardArea();
+    Executor::getSession()->heapModifier.addFloat(offset, amount);
+    Executor::unGuard();
+}
+
 void argc::resize_chunk(int32 new_size) {
     Executor::guardArea();
     Executor::getSession()->heapModifier.updateChunkSize(new_size);
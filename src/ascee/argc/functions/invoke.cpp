@@ -27,12 +27,12 @@ using namespace runtime;
 void argc::enter_area() {
     if (Executor::getSession()->currentCall->hasLock) return;
 
-    auto app = Executor::getSession()->currentCall->appID;
-    if (Executor::getSession()->isLocked[app]) {
+    auto slot = Executor::getSession()->currentCall->slot;
+    if (Executor::getSession()->lockTable.isLocked(slot)) {
         throw Executor::Error("reentrancy is not allowed", StatusCode::reentrancy_attempt);
     } else {
         Executor::guardArea();
-        Executor::getSession()->isLocked[app] = true;
+        Executor::getSession()->lockTable.lock(slot);
         Executor::getSession()->currentCall->hasLock = true;
         Executor::unGuard();
     }
@@ -41,7 +41,7 @@ void argc::enter_area() {
 void argc::exit_area() {
     Executor::guardArea();
     if (Executor::getSession()->currentCall->hasLock) {
-        Executor::getSession()->isLocked[Executor::getSession()->currentCall->appID] = false;
+        Executor::getSession()->lockTable.unlock(Executor::getSession()->currentCall->slot);
         Executor::getSession()->currentCall->hasLock = false;
     }
     Executor::unGuard();
@@ -51,26 +51,27 @@ void argc::invoke_deferred(long_id app_id, response_buffer_c& response, string_v
     Executor::getSession()->currentCall->deferredCalls.emplace_back(DeferredArgs{
             .appID = app_id,
             // string constructor makes a copy of its input, so we should be safe here.
-            .request = std::string(request),
+            .request = std::pmr::string(std::string_view(request), &Executor::getSession()->skeleton->arena),
     });
 }
 
 void argc::revert(string_view_c msg) {
     Executor::guardArea();
-    throw Executor::Error(std::string(msg), StatusCode::bad_request);
+    throw Executor::Error(std::string_view(msg), StatusCode::bad_request);
 }
 
 int argc::dependant_call(long_id app_id, response_buffer_c& response, string_view_c request) {
     Executor::guardArea();
+    long slot;
     try {
-        Executor::getSession()->appTable.checkApp(app_id);
+        slot = Executor::getSession()->appTable.checkApp(app_id);
     } catch (const AsceeError& err) {
         throw Executor::Error(err);
     }
 
-    Executor::CallContext callContext(app_id);
+    Executor::CallContext callContext(app_id, slot);
 
-    int jmpRet = sigsetjmp(callContext.env, true);
+    int jmpRet = sigsetjmp(callContext.env, false);
     Executor::guardArea();
 
     int ret = 0;
@@ -81,7 +82,7 @@ int argc::dependant_call(long_id app_id, response_buffer_c& response, string_vie
 
                 ~UnGuarder() noexcept { Executor::guardArea(); }
             } dummy;
-            ret = Executor::getSession()->appTable.callApp(app_id, response, request);
+            ret = Executor::getSession()->appTable.callApp(slot, response, request);
         } catch (const std::out_of_range& err) {
             throw Executor::Error(err.what(), StatusCode::out_of_range);
         }
@@ -18,6 +18,11 @@
 #ifndef ARGENNON_ARGC_TYPES_H
 #define ARGENNON_ARGC_TYPES_H
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <initializer_list>
+#include <string_view>
 #include <core/primitives.h>
 #include "StringBuffer.h"
 #include "util/crypto/Keys.h"
@@ -95,27 +100,86 @@ constexpr const char* gReasonByStatusCode(StatusCode code) {
     return "Unknown Reason";
 }
 
+/**
+ * An error of the execution environment. The message of an error is kept in a small inline buffer, so creating,
+ * copying and reporting an AsceeError does not allocate memory on the heap. Messages longer than
+ * `max_message_size` are truncated.
+ */
 class AsceeError : public std::exception {
 public:
+    static constexpr int max_message_size = 256;
+
+    /// A part of an error message, which can be a string, an identifier or a number.
+    class MessagePart {
+    public:
+        MessagePart(std::string_view str) noexcept: view(str) {} // NOLINT(google-explicit-constructor)
+
+        MessagePart(const char* str) noexcept: view(str) {} // NOLINT(google-explicit-constructor)
+
+        MessagePart(LongID id) noexcept: view(buffer, util::toHex(id, buffer)) {} // NOLINT(google-explicit-constructor)
+
+        MessagePart(uint64_t n) noexcept: // NOLINT(google-explicit-constructor)
+                view(buffer, std::to_chars(buffer, buffer + sizeof(buffer), n).ptr - buffer) {}
+
+        MessagePart(const MessagePart&) = delete;
+
+        [[nodiscard]] std::string_view get() const { return view; }
+
+    private:
+        char buffer[24];
+        std::string_view view;
+    };
+
     ~AsceeError() override = default;
 
     explicit AsceeError(
-            std::string msg,
+            std::string_view msg,
             StatusCode code = StatusCode::internal_error,
-            std::string thrower = ""
-    ) noexcept: msg(std::move(msg)),
-                thrower(std::move(thrower)),
-                code(code),
-                message(this->thrower.empty() ? this->msg : "[" + this->thrower + "]-> " + this->msg) {}
+            std::string_view thrower = ""
+    ) noexcept: code(code) {
+        init(thrower);
+        append(msg);
+    }
+
+    AsceeError(
+            StatusCode code,
+            std::initializer_list<MessagePart> msg,
+            std::string_view thrower = ""
+    ) noexcept: code(code) {
+        init(thrower);
+        for (const auto& part: msg) append(part.get());
+    }
+
+    AsceeError(const AsceeError& other) noexcept: code(other.code), length(other.length) {
+        std::memcpy(message, other.message, length + 1);
+    }
 
     [[nodiscard]] int errorCode() const { return (int) code; }
 
-    [[nodiscard]] const char* what() const noexcept override { return message.c_str(); }
+    [[nodiscard]] const char* what() const noexcept override { return message; }
+
+    [[nodiscard]] std::string_view getMessage() const { return {message, std::size_t(length)}; }
 
-    const std::string msg;
-    const std::string thrower;
     const StatusCode code;
-    const std::string message;
+
+private:
+    int length = 0;
+    char message[max_message_size + 1];
+
+    void init(std::string_view thrower) noexcept {
+        message[0] = 0;
+        if (thrower.empty()) return;
+        append("[");
+        append(thrower);
+        append("]-> ");
+    }
+
+    void append(std::string_view str) noexcept {
+        auto n = std::min<std::size_t>(str.size(), max_message_size - length);
+        std::memcpy(message + length, str.data(), n);
+        length += int(n);
+        message[length] = 0;
+    }
 };
 
 typedef int (* DispatcherPointer)(response_buffer_c& response, string_view_c request);
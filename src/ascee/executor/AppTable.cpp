@@ -21,18 +21,28 @@ using namespace argennon;
 using namespace ascee::runtime;
 
 int AppTable::callApp(long_id appID, response_buffer_c& response, string_view_c request) const {
-    return callTable.at(appID)(response, request);
+    auto slot = dispatchTable->findSlot(appID);
+    if (!isAllowed(slot)) throw std::out_of_range("app is not declared");
+    return callApp(slot, response, request);
 }
 
-void AppTable::checkApp(long_id appID) const {
-    try {
-        if (callTable.at(appID) == nullptr) {
-            throw AsceeError("app does not exist", StatusCode::not_found);
-        }
-    } catch (const std::out_of_range&) {
-        throw AsceeError("app/" + (std::string) appID + " was not declared in the call list",
-                         StatusCode::limit_violated);
+long AppTable::checkApp(long_id appID) const {
+    auto slot = dispatchTable->findSlot(appID);
+    if (!isAllowed(slot)) {
+        throw AsceeError(StatusCode::limit_violated, {"app/", appID, " was not declared in the call list"});
     }
+    if (dispatchTable->getDispatcher(slot) == nullptr) {
+        throw AsceeError("app does not exist", StatusCode::not_found);
+    }
+    return slot;
 }
 
-AppTable::AppTable(util::OrderedStaticMap<long_id, DispatcherPointer> callTable) : callTable(std::move(callTable)) {}
+AppTable::AppTable(std::shared_ptr<const DispatchTable> dispatchTable, const std::vector<long_id>& sortedAppList) :
+        dispatchTable(std::move(dispatchTable)),
+        allowedSlots((this->dispatchTable->size() + 63) / 64) {
+    for (const auto& appID: sortedAppList) {
+        auto slot = this->dispatchTable->findSlot(appID);
+        if (slot < 0) throw std::out_of_range("app:" + (std::string) appID + " is not in the dispatch table");
+        allowedSlots[slot >> 6] |= uint64_t(1) << (slot & 63);
+    }
+}
@@ -18,23 +18,66 @@
 #ifndef ARGENNON_CORE_APP_TABLE_H
 #define ARGENNON_CORE_APP_TABLE_H
 
-#include <unordered_map>
+#include <memory>
+#include <vector>
 #include "argc/types.h"
 #include "util/OrderedStaticMap.hpp"
 
 namespace argennon::ascee::runtime {
 
+/**
+ * An immutable table containing the dispatchers of all apps that can be called in a block. Every app has a dense
+ * slot number, which is its index in the table. A single DispatchTable is shared between all requests of a block.
+ */
+class DispatchTable {
+public:
+    explicit DispatchTable(util::OrderedStaticMap<long_id, DispatcherPointer> dispatchers) :
+            dispatchers(std::move(dispatchers)) {}
+
+    /// returns the slot of @p appID or -1 if the app is not in the table.
+    [[nodiscard]]
+    long findSlot(long_id appID) const { return dispatchers.indexOf(appID); }
+
+    [[nodiscard]]
+    DispatcherPointer getDispatcher(long slot) const { return dispatchers.getValues()[slot]; }
+
+    [[nodiscard]]
+    long size() const { return dispatchers.size(); }
+
+private:
+    const util::OrderedStaticMap<long_id, DispatcherPointer> dispatchers;
+};
 
+/**
+ * The apps that a request is allowed to call. An AppTable only holds a bitmask of the allowed slots of the block's
+ * DispatchTable.
+ */
 class AppTable {
 public:
-    explicit AppTable(util::OrderedStaticMap<long_id, DispatcherPointer> callTable);
+    AppTable(std::shared_ptr<const DispatchTable> dispatchTable, const std::vector<long_id>& sortedAppList);
 
     int callApp(long_id appID, response_buffer_c& response, string_view_c request) const;
 
-    void checkApp(long_id appID) const;
+    /// calls the app in @p slot. The slot must be obtained by calling checkApp().
+    int callApp(long slot, response_buffer_c& response, string_view_c request) const {
+        return dispatchTable->getDispatcher(slot)(response, request);
+    }
+
+    /// checks that the app can be called and returns the slot of the app.
+    long checkApp(long_id appID) const;
+
+    /// returns the number of slots of the dispatch table. Slots of an AppTable are always less than this number.
+    [[nodiscard]]
+    long getSlotCount() const { return dispatchTable->size(); }
+
+    [[nodiscard]]
+    bool isAllowed(long slot) const {
+        return slot >= 0 && (allowedSlots[slot >> 6] >> (slot & 63)) & 1;
+    }
 
 private:
-    util::OrderedStaticMap<long_id, DispatcherPointer> callTable;
+    std::shared_ptr<const DispatchTable> dispatchTable;
+    std::vector<uint64_t> allowedSlots;
 };
 
 } // namespace argennon::ascee::runtime
@@ -17,32 +17,31 @@
 
 #include <csignal>
 #include <stdexcept>
-#include "ThreadCpuTimer.h"
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "CpuBudgetManager.h"
 
 using namespace argennon::ascee;
 using namespace argennon::ascee::runtime;
 
-ThreadCpuTimer::ThreadCpuTimer() {
+CpuBudgetManager::CpuBudgetManager() {
     timer = nullptr;
-    thread = pthread_self();
 
-    // Creating the execution timer
+    // The timer's signal is delivered to this thread, so the signal handler does not need to redirect it.
     struct sigevent sev{};
-    sev.sigev_notify = SIGEV_SIGNAL;
-    sev.sigev_signo = SIGALRM;
-    sev.sigev_value.sival_ptr = &thread;
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGUSR1;
+    sev._sigev_un._tid = pid_t(syscall(SYS_gettid));
     if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &timer) != 0) {
         throw std::runtime_error("error in creating the cpu timer");
     }
 }
 
-ThreadCpuTimer::~ThreadCpuTimer() {
+CpuBudgetManager::~CpuBudgetManager() {
     timer_delete(timer);
-    printf("timer deleted\n");
 }
 
-/// in the implementation of this function nsec = 0 should always stop the timer.
-int64_t ThreadCpuTimer::setAlarm(int64_t nsec) {
+int64_t CpuBudgetManager::setAlarm(int64_t nsec) {
     struct itimerspec its{};
 
     // Get the remaining time
@@ -60,3 +59,17 @@ int64_t ThreadCpuTimer::setAlarm(int64_t nsec) {
     return remaining;
 }
 
+CpuBudgetManager& CpuBudgetManager::local() {
+    static thread_local CpuBudgetManager manager;
+    return manager;
+}
+
+CpuBudgetManager::Budget::Budget(int64_t nsec) : enclosingBudget(local().setAlarm(nsec)) {}
+
+CpuBudgetManager::Budget::~Budget() noexcept {
+    try {
+        local().setAlarm(enclosingBudget);
+    } catch (const std::runtime_error&) {
+        // timer_settime only fails for invalid arguments, which is not possible here.
+    }
+}
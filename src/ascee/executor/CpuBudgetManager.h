@@ -15,26 +15,50 @@
 // You should have received a copy of the GNU Affero General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
-#ifndef ARGENNON_THREAD_CPU_TIMER_H
-#define ARGENNON_THREAD_CPU_TIMER_H
+#ifndef ARGENNON_CPU_BUDGET_MANAGER_H
+#define ARGENNON_CPU_BUDGET_MANAGER_H
 
 #include <ctime>
-#include <pthread.h>
+#include <cstdint>
 
 namespace argennon::ascee::runtime {
 
-class ThreadCpuTimer {
-private:
-    pthread_t thread;
-    timer_t timer;
+/**
+ * Every thread has a single cpu timer which is created the first time the thread uses its budget manager and is
+ * deleted when the thread exits. When a budget is exhausted SIGUSR1 is sent directly to the owner thread.
+ *
+ * Nested budgets are managed by instances of Budget, which must be created in a LIFO order. A Budget pauses the
+ * budget of its enclosing scope and restores its remaining time when destroyed.
+ */
+class CpuBudgetManager {
 public:
-    ThreadCpuTimer();
+    class Budget {
+    public:
+        explicit Budget(int64_t nsec);
+
+        Budget(const Budget&) = delete;
+
+        ~Budget() noexcept;
+
+    private:
+        int64_t enclosingBudget;
+    };
+
+    CpuBudgetManager(const CpuBudgetManager&) = delete;
 
-    virtual ~ThreadCpuTimer();
+    ~CpuBudgetManager();
 
+    /// in the implementation of this function nsec = 0 should always stop the timer.
     int64_t setAlarm(int64_t nsec);
+
+    static CpuBudgetManager& local();
+
+private:
+    timer_t timer;
+
+    CpuBudgetManager();
 };
 
 } // namespace argennon::ascee::runtime
 
-#endif // ARGENNON_THREAD_CPU_TIMER_H
+#endif // ARGENNON_CPU_BUDGET_MANAGER_H
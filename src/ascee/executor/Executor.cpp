@@ -16,9 +16,12 @@
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include <pthread.h>
+#include <ucontext.h>
+#include <unistd.h>
 #include <csignal>
 #include <argc/functions.h>
 #include <argc/types.h>
+#include <algorithm>
 #include <thread>
 #include "Executor.h"
 
@@ -27,52 +30,117 @@ using namespace ascee;
 using namespace runtime;
 using std::unique_ptr, std::string, std::string_view, std::to_string, std::function;
 
-static inline
-void maskSignals(int how) {
-    sigset_t set;
+namespace {
+class RecoveryStack {
+public:
+    RecoveryStack() {
+        stack_t sig_stack;
 
-// Block timer's signal
-    sigemptyset(&set);
-    sigaddset(&set, SIGUSR1);
-    sigaddset(&set, SIGKILL);
-    int s = pthread_sigmask(how, &set, nullptr);
-    if (s != 0) throw std::runtime_error("error in masking signals");
+        sig_stack.ss_sp = malloc(SIGSTKSZ);
+        if (sig_stack.ss_sp == nullptr) throw std::runtime_error("could not allocate memory for the recovery stack");
 
-}
+        sig_stack.ss_size = SIGSTKSZ;
+        sig_stack.ss_flags = 0;
 
-void* Executor::registerRecoveryStack() {
-    stack_t sig_stack;
+        int err = sigaltstack(&sig_stack, nullptr);
+        if (err) throw std::runtime_error("error in registering the recovery stack");
 
-    sig_stack.ss_sp = malloc(SIGSTKSZ);
-    if (sig_stack.ss_sp == nullptr) throw std::runtime_error("could not allocate memory for the recovery stack");
+        memory = sig_stack.ss_sp;
+    }
 
-    sig_stack.ss_size = SIGSTKSZ;
-    sig_stack.ss_flags = 0;
+    ~RecoveryStack() noexcept {
+        stack_t disabled{};
+        disabled.ss_flags = SS_DISABLE;
+        sigaltstack(&disabled, nullptr);
+        free(memory);
+    }
 
-    int err = sigaltstack(&sig_stack, nullptr);
-    if (err) throw std::runtime_error("error in registering the recovery stack");
+private:
+    void* memory;
+};
+}
 
-    return sig_stack.ss_sp;
+static
+int invoke_noexcept(long_id app_id, response_buffer_c& response, string_view_c request) {
+    int ret;
+    try {
+        ret = argc::dependant_call(app_id, response, request);
+    } catch (const Executor::Error& ee) {
+        ret = ee.errorCode();
+        ee.toHttpResponse(response.clear());
+    }
+    return ret;
 }
 
-void Executor::sig_handler(int sig, siginfo_t* info, void*) {
-    printf("Caught signal %d\n", sig);
-    // important: session is not valid when sig == SIGALRM
-    if (sig != SIGALRM) {
-        if (session->guardedArea) {
-            printf("A signal was raised from guarded area.\n");
-            std::terminate();
+namespace {
+template<class Function>
+struct FiberTask {
+    Function& function;
+    std::exception_ptr error;
+
+    /// makecontext() only passes int arguments, so the address of the task is split into two halves.
+    static void start(unsigned int taskHigh, unsigned int taskLow) {
+        auto* task = reinterpret_cast<FiberTask*>((uintptr_t(taskHigh) << 32) | uintptr_t(taskLow));
+        // Exceptions can not cross the boundary of a fiber, they are rethrown in the caller's context.
+        try {
+            task->function();
+        } catch (...) {
+            task->error = std::current_exception();
         }
-        int ret = static_cast<int>(StatusCode::internal_error);
-        if (sig == SIGSEGV) ret = static_cast<int>(StatusCode::memory_fault);
-        else if (sig == SIGUSR1) ret = static_cast<int>(StatusCode::execution_timeout);
-        else if (sig == SIGFPE || sig == SIGILL) ret = static_cast<int>(StatusCode::arithmetic_error);
-        siglongjmp(session->currentCall->env, ret);
-    } else {
-        pthread_t thread_id = *static_cast<pthread_t*>(info->si_value.sival_ptr);
-        printf("Caught signal %d for app %ld\n", sig, thread_id);
-        pthread_kill(thread_id, SIGUSR1);
+        // returning from here resumes the caller through uc_link.
+    }
+};
+}
+
+/// runs @p function on @p stack and returns when the function returns.
+template<class Function>
+static
+void runOnFiber(const StackPool::Stack& stack, Function& function) {
+    FiberTask<Function> task{function, nullptr};
+
+    ucontext_t callerContext, fiberContext;
+    if (getcontext(&fiberContext) != 0) throw std::runtime_error(to_string(errno) + ": getcontext failed");
+    fiberContext.uc_stack.ss_sp = stack.getBase();
+    fiberContext.uc_stack.ss_size = stack.getSize();
+    fiberContext.uc_link = &callerContext;
+    auto taskAddress = reinterpret_cast<uintptr_t>(&task);
+    makecontext(&fiberContext, reinterpret_cast<void (*)()>(FiberTask<Function>::start), 2,
+                unsigned(taskAddress >> 32), unsigned(taskAddress & 0xffffffff));
+
+    if (swapcontext(&callerContext, &fiberContext) != 0) {
+        throw std::runtime_error(to_string(errno) + ": swapcontext failed");
     }
+    if (task.error) std::rethrow_exception(task.error);
+}
+
+/// The recovery stack is registered once per thread and is shared between all the fibers of that thread.
+void Executor::registerRecoveryStack() {
+    static thread_local RecoveryStack recoveryStack;
+}
+
+void Executor::sig_handler(int sig, siginfo_t*, void* ucontext) {
+    // a cpu timer that expired after its session was finished.
+    if (sig == SIGUSR1 && session == nullptr) return;
+
+    if (session->guardedArea || session->abandoned) {
+        if (sig == SIGUSR1) {
+            // the timeout will be delivered by unGuard()
+            session->pendingTimeout = true;
+            return;
+        }
+        // printf is not async-signal-safe.
+        constexpr char message[] = "A signal was raised from guarded area.\n";
+        [[maybe_unused]] auto written = write(STDERR_FILENO, message, sizeof(message) - 1);
+        std::terminate();
+    }
+    int ret = static_cast<int>(StatusCode::internal_error);
+    if (sig == SIGSEGV) ret = static_cast<int>(StatusCode::memory_fault);
+    else if (sig == SIGUSR1) ret = static_cast<int>(StatusCode::execution_timeout);
+    else if (sig == SIGFPE || sig == SIGILL) ret = static_cast<int>(StatusCode::arithmetic_error);
+    // call environments do not save the signal mask, so we need to unblock the signals that were blocked when
+    // the handler was invoked.
+    pthread_sigmask(SIG_SETMASK, &static_cast<ucontext_t*>(ucontext)->uc_sigmask, nullptr);
+    siglongjmp(session->currentCall->env, ret);
 }
 
 void Executor::initHandlers() {
@@ -82,7 +150,6 @@ void Executor::initHandlers() {
     sigfillset(&action.sa_mask);
 
     int err = 0;
-    err += sigaction(SIGALRM, &action, nullptr);
     err += sigaction(SIGFPE, &action, nullptr);
     err += sigaction(SIGILL, &action, nullptr);
     err += sigaction(SIGSEGV, &action, nullptr);
@@ -91,48 +158,103 @@ void Executor::initHandlers() {
     if (err) throw std::runtime_error("error in creating handlers");
 }
 
-void Executor::ControlledCaller::guardArea_() {
-    session->guardedArea = true;
-    maskSignals(SIG_BLOCK);
-}
-
-void Executor::ControlledCaller::unGuard_() {
-    maskSignals(SIG_UNBLOCK);
-    session->guardedArea = false;
+void Executor::deliverPendingTimeout() {
+    // the root context does not have a call environment. The timeout remains pending until the next unGuard().
+    if (session->currentCall == nullptr || session->currentCall->prevCallInfo == nullptr) return;
+    if (session->abandoned) return;
+    session->pendingTimeout = false;
+    siglongjmp(session->currentCall->env, static_cast<int>(StatusCode::execution_timeout));
 }
 
 // must be thread-safe
 AppResponse Executor::executeOne(AppRequest* req) {
+    prepareOwnedSlab(1);
+    SessionSkeleton skeleton;
+    return execute(req, skeleton);
+}
+
+std::vector<AppResponse> Executor::executeBatch(std::span<AppRequest* const> requests) {
+    prepareOwnedSlab(requests.size());
+    SessionSkeleton skeleton;
+    std::vector<AppResponse> responses;
+    responses.reserve(requests.size());
+    for (auto* req: requests) {
+        responses.emplace_back(execute(req, skeleton));
+    }
+    return responses;
+}
+
+AppResponse Executor::executeSpeculatively(AppRequest* req) {
+    prepareOwnedSlab(1);
+    SessionSkeleton skeleton;
+    return execute(req, skeleton, false);
+}
+
+AppResponse Executor::execute(AppRequest* req, SessionSkeleton& skeleton, bool commit) {
     response_buffer_c response;
     int statusCode;
     session = nullptr;
+    registerRecoveryStack();
+    // everything allocated from the arena belonged to the previous session, which is destroyed now.
+    skeleton.arena.release();
+    skeleton.lockTable.reset(req->appTable.getSlotCount());
     try {
         SessionInfo threadSession{
                 .request = req,
+                .skeleton = &skeleton,
                 //.cryptoSigner = cryptoSigner,
         };
         session = &threadSession;
         if (req->useControlledExecution) {
-            session->callManager = std::make_unique<ControlledCaller>();
-            ControlledCaller::CallResourceHandler rootResourceCtx(req->maxClocks);
-            CallContext rootInfoCtx;
-            statusCode = callApp(255, req->calledAppID, response, string_view_c(req->httpRequest));
-            rootResourceCtx.complete();
+            bool completed = false;
+            if (req->optimisticFirst) {
+                session->callManager = &skeleton.inlineCaller;
+                auto attempt = [&] {
+                    ControlledCaller::CallResourceHandler rootResourceCtx(req->maxClocks);
+                    CallContext rootInfoCtx;
+                    statusCode = callApp(255, req->calledAppID, response, string_view_c(req->httpRequest));
+                    rootResourceCtx.complete();
+                };
+                try {
+                    runOnFiber(StackPool::local().acquire(FailureManager::default_stack_size), attempt);
+                    completed = true;
+                } catch (const InlineCaller::Failure&) {
+                    resetSession();
+                    response.clear();
+                    session->callManager = &skeleton.controlledCaller;
+                }
+            }
+            if (!completed) {
+                ControlledCaller::CallResourceHandler rootResourceCtx(req->maxClocks);
+                CallContext rootInfoCtx;
+                statusCode = callApp(255, req->calledAppID, response, string_view_c(req->httpRequest));
+                rootResourceCtx.complete();
+            }
         } else {
-            session->callManager = std::make_unique<OptimisticCaller>();
-            ThreadCpuTimer cpuTimer;
-            cpuTimer.setAlarm(default_exec_time_nsec);
+            CpuBudgetManager::Budget budget(default_exec_time_nsec);
             CallContext rootInfoCtx;
             statusCode = callApp(255, req->calledAppID, response, string_view_c(req->httpRequest));
         }
-        session->heapModifier.writeToHeap();
+        if (commit) session->heapModifier.writeToHeap();
     } catch (const std::out_of_range& err) {
         //todo: fix this
         throw std::runtime_error("why???");
     }
     session = nullptr;
 
-    return {statusCode, string((StringView) response)};
+    return {statusCode, responseSlab->store(std::string_view(response))};
+}
+
+void Executor::resetSession() {
+    session->heapModifier.reset();
+    session->failureManager.reset();
+    session->sigManager.reset();
+    session->lockTable.reset(session->appTable.getSlotCount());
+    session->currentCall = nullptr;
+    session->currentResources = nullptr;
+    session->guardedArea = false;
+    session->pendingTimeout = false;
+    session->abandoned = false;
 }
 
 int Executor::callApp(byte forwarded_gas, long_id app_id, response_buffer_c& response, string_view_c request) {
@@ -143,110 +265,129 @@ Executor::Executor() {
     if (!initialized.exchange(true)) initHandlers();
 }
 
-Executor::CallContext::CallContext(long_id app) : appID(app) {
+Executor::Executor(ResponseSlab& responseSlab) : responseSlab(&responseSlab) {
+    if (!initialized.exchange(true)) initHandlers();
+}
+
+void Executor::prepareOwnedSlab(std::size_t responseCount) {
+    if (responseSlab && !ownedSlab) return;
+    auto capacity = std::max<std::size_t>(responseCount, 1) * ResponseSlab::max_response_size;
+    if (ownedSlab && ownedSlab->getCapacity() >= capacity) {
+        ownedSlab->reset();
+    } else {
+        ownedSlab = std::make_unique<ResponseSlab>(capacity);
+        responseSlab = ownedSlab.get();
+    }
+}
+
+Executor::CallContext::CallContext(long_id app, long slot) : appID(app), slot(slot) {
     prevCallInfo = session->currentCall;
     if (prevCallInfo->appID == app) throw Error("calling self", StatusCode::invalid_operation, app);
     session->heapModifier.loadContext(app);
+    callerPendingTimeout = session->pendingTimeout;
+    session->pendingTimeout = false;
     session->currentCall = this;
 }
 
 Executor::CallContext::CallContext() : appID(0) {
     prevCallInfo = nullptr;
+    callerPendingTimeout = session->pendingTimeout;
+    session->pendingTimeout = false;
     session->currentCall = this;
 }
 
 Executor::CallContext::~CallContext() noexcept {
     guardArea();
-    argc::exit_area();
+    // the entrance lock is released without calling argc::exit_area(), since that would unguard the area.
+    if (hasLock) {
+        session->lockTable.unlock(slot);
+        hasLock = false;
+    }
 
     // restore context
     if (prevCallInfo != nullptr) session->heapModifier.loadContext(prevCallInfo->appID);
 
-    // restore previous call info
+    // A timeout postponed near the end of this call belongs to this call, which is finished. It is discarded before
+    // the caller's call info is restored.
+    session->pendingTimeout = callerPendingTimeout;
     session->currentCall = prevCallInfo;
-    unGuard();
+    // The area is not unguarded here. This destructor may run on the stack of a fiber, and delivering a timeout
+    // would jump to the caller's environment without unwinding the frames of the call manager. Call managers
+    // unguard the area after they regain control, and deliver the caller's pending timeout there.
 }
 
 
-struct InvocationArgs {
-    long_id app_id;
-    ascee::string_view_c request;
-    ascee::response_buffer_c& response;
-    int_fast64_t execTime;
-    Executor::SessionInfo* session;
-};
-
-static
-int invoke_noexcept(long_id app_id, response_buffer_c& response, string_view_c request) {
+int Executor::ControlledCaller::executeApp(byte forwarded_gas, long_id app_id,
+                                           response_buffer_c& response, string_view_c request) {
+    guardArea();
     int ret;
     try {
-        ret = argc::dependant_call(app_id, response, request);
-    } catch (const Executor::Error& ee) {
-        ret = ee.errorCode();
-        ee.toHttpResponse(response.clear());
+        CallResourceHandler resourceContext(forwarded_gas);
+        auto stack = StackPool::local().acquire(resourceContext.getStackSize());
+
+        ret = int(StatusCode::internal_error);
+        auto invocation = [&] { ret = invoke_noexcept(app_id, response, request); };
+        bool callerTimedOut = session->pendingTimeout;
+        {
+            // The caller's cpu budget is paused while the callee is running.
+            CpuBudgetManager::Budget budget(resourceContext.getExecTime());
+            runOnFiber(stack, invocation);
+        }
+        // the callee's timer may expire after its call context is destroyed, but such a timeout should not be
+        // delivered to the caller.
+        session->pendingTimeout = callerTimedOut;
+
+        if (ret < 400) resourceContext.complete();
+    } catch (const AsceeError& ae) {
+        ret = ae.errorCode();
+        Executor::Error(ae).toHttpResponse(response.clear());
     }
+    // unGuard() should be called here, in case resourceContext's constructor throws an exception.
+    unGuard();
     return ret;
 }
 
-void* Executor::ControlledCaller::threadStart(void* voidArgs) {
-    auto* args = (InvocationArgs*) voidArgs;
-
-    void* recoveryStack = registerRecoveryStack();
-    session = args->session;
-
-    int* ret = (int*) malloc(sizeof(int));
-    if (ret == nullptr) throw std::runtime_error("memory allocation error");
-
-    ThreadCpuTimer cpuTimer;
-    cpuTimer.setAlarm(args->execTime);
-
-    *ret = invoke_noexcept(args->app_id, args->response, args->request);
-
-    free(recoveryStack);
-    return ret;
+/// errors caused by the resources of the thread, which a ControlledCaller could handle differently.
+static inline
+bool isResourceFailure(int statusCode) {
+    switch (StatusCode(statusCode)) {
+        case StatusCode::execution_timeout:
+        case StatusCode::memory_fault:
+        case StatusCode::arithmetic_error:
+        case StatusCode::internal_error:
+            return true;
+        default:
+            return false;
+    }
 }
 
-int Executor::ControlledCaller::executeApp(byte forwarded_gas, long_id app_id,
-                                           response_buffer_c& response, string_view_c request) {
-    guardArea_();
+int Executor::InlineCaller::executeApp(byte forwarded_gas, long_id app_id,
+                                       response_buffer_c& response, string_view_c request) {
+    guardArea();
     int ret;
     try {
-        CallResourceHandler resourceContext(forwarded_gas);
-        pthread_t threadID;
-        pthread_attr_t threadAttr;
-
-        int err = pthread_attr_init(&threadAttr);
-        if (err) throw std::runtime_error(to_string(errno) + ": failed to init thread attributes");
-
-        err = pthread_attr_setstacksize(&threadAttr, resourceContext.getStackSize());
-        if (err) throw std::runtime_error(to_string(errno) + ": can't set stack size");
-
-        InvocationArgs args = {
-                .app_id = app_id,
-                .request = request,
-                .response = response,
-                .execTime = resourceContext.getExecTime(),
-                .session = Executor::getSession()
-        };
-
-        err = pthread_create(&threadID, &threadAttr, threadStart, &args);
-        if (err) throw std::runtime_error(to_string(errno) + ": thread creation failed");
-
-        pthread_attr_destroy(&threadAttr);
-        // We ignore errors here
-
-        void* retPtr;
-        err = pthread_join(threadID, &retPtr);
-        ret = err ? int(StatusCode::internal_error) : *(int*) retPtr;
-
-        free(retPtr);
+        ControlledCaller::CallResourceHandler resourceContext(forwarded_gas);
+        // we only need to check the call depth, since the stack size of a controlled call is never less than the size
+        // of the stack that is shared by inline calls.
+        (void) resourceContext.getStackSize();
+        bool callerTimedOut = session->pendingTimeout;
+        {
+            CpuBudgetManager::Budget budget(resourceContext.getExecTime());
+            ret = invoke_noexcept(app_id, response, request);
+        }
+        // see ControlledCaller::executeApp()
+        session->pendingTimeout = callerTimedOut;
+        // the callee may have been stopped by a timer or a signal, so the request must be executed again.
+        if (isResourceFailure(ret)) {
+            session->abandoned = true;
+            throw Failure();
+        }
         if (ret < 400) resourceContext.complete();
     } catch (const AsceeError& ae) {
         ret = ae.errorCode();
         Executor::Error(ae).toHttpResponse(response.clear());
     }
-    // unBlockSignals() should be called here, in case resourceContext's constructor throws an exception.
-    unGuard_();
+    unGuard();
     return ret;
 }
 
@@ -278,7 +419,8 @@ Executor::ControlledCaller::CallResourceHandler::CallResourceHandler(int_fast32_
     gas = 0;
     remainingExternalGas = initialGas;
     session->currentResources = this;
-    heapVersion = 0;
+    // the root call needs its own version, otherwise a failed root call could not discard its modifications.
+    heapVersion = session->heapModifier.saveVersion();
 }
 
 Executor::ControlledCaller::CallResourceHandler::~CallResourceHandler() noexcept {
@@ -310,12 +452,12 @@ Executor::OptimisticCaller::CallResourceHandler::~CallResourceHandler() noexcept
 
 int Executor::OptimisticCaller::executeApp(byte forwarded_gas, long_id app_id,
                                            response_buffer_c& response, string_view_c request) {
-    guardArea_();
+    guardArea();
     try {
         CallResourceHandler resourceContext;
         auto ret = argc::dependant_call(app_id, response, request);
         if (ret < 400) resourceContext.complete();
-        unGuard_();
+        unGuard();
         return ret;
     } catch (const AsceeError& ae) {
         throw BlockError("an optimistic call failed");
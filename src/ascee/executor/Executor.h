@@ -22,12 +22,19 @@
 #include <csignal>
 #include <csetjmp>
 
+#include <algorithm>
+#include <atomic>
+
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "executor/FailureManager.h"
-#include "ThreadCpuTimer.h"
+#include "CpuBudgetManager.h"
+#include "ResponseSlab.h"
+#include "StackPool.h"
 #include "VirtualSignatureManager.h"
 #include "AppTable.h"
 #include "heap/RestrictedModifier.h"
@@ -67,20 +74,24 @@ struct AppRequest {
     HeapModifier modifier;
     AppTable appTable;
     bool useControlledExecution;
+    /// when set, a controlled request is first executed by an InlineCaller, and only if that fails, it will be
+    /// executed again using a ControlledCaller. This should only be used for requests that declare no failures.
+    bool optimisticFirst = false;
     FailureManager failureManager;
     std::vector<AppRequestIdType> attachments;
     VirtualSignatureManager signatureManager;
     Digest digest;
 };
 
+/// The content of a response is stored in the ResponseSlab of the executor that executed the request.
 struct AppResponse {
     int statusCode;
-    std::string httpResponse;
+    std::string_view httpResponse;
 };
 
 struct DeferredArgs {
     long_id appID;
-    std::string request;
+    std::pmr::string request;
 };
 
 class Executor {
@@ -89,11 +100,6 @@ private:
     public:
         virtual int executeApp(byte forwarded_gas, long_id app_id,
                                response_buffer_c& response, string_view_c request) = 0;
-
-        virtual void guardArea_() = 0;
-
-        virtual void unGuard_() = 0;
-
     };
 
     class ControlledCaller : public CallManager {
@@ -125,12 +131,22 @@ private:
         int executeApp(byte forwarded_gas, long_id app_id,
                        response_buffer_c& response, string_view_c request) override;
 
-        void guardArea_() override;
+    };
 
-        void unGuard_() override;
+    /**
+     * Runs all calls of a request on a single stack, while doing the same resource accounting of a ControlledCaller.
+     * Errors of a callee are returned to the caller like a ControlledCaller, but a timeout or a signal aborts the whole
+     * execution by throwing a Failure, after which the request must be executed again by a ControlledCaller. When no failure happens, the result is the same as using a ControlledCaller, because the
+     * stack shared by the calls is not larger than the stack of a controlled call and every call still has its own
+     * cpu budget.
+     */
+    class InlineCaller : public CallManager {
+    public:
+        struct Failure {
+        };
 
-    private:
-        static void* threadStart(void* voidArgs);
+        int executeApp(byte forwarded_gas, long_id app_id,
+                       response_buffer_c& response, string_view_c request) override;
     };
 
     class OptimisticCaller : public CallManager {
@@ -151,10 +167,6 @@ private:
 
         int executeApp(byte forwarded_gas, long_id app_id,
                        response_buffer_c& response, string_view_c request) override;
-
-        void guardArea_() override {}
-
-        void unGuard_() override {}
     };
 
 public:
@@ -169,22 +181,31 @@ public:
         ) noexcept: AsceeError(ae), app(app) {}
 
         explicit Error(
-                const std::string& msg,
+                std::string_view msg,
                 StatusCode code = StatusCode::internal_error,
-                const std::string& thrower = "",
+                std::string_view thrower = "",
                 long_id app = session->currentCall->appID
         ) noexcept: AsceeError(msg, code, thrower), app(app) {}
 
-        explicit Error(const std::string& msg, StatusCode code, long_id app) noexcept:
+        explicit Error(std::string_view msg, StatusCode code, long_id app) noexcept:
                 AsceeError(msg, code, ""), app(app) {}
 
+        Error(
+                StatusCode code,
+                std::initializer_list<MessagePart> msg,
+                std::string_view thrower = "",
+                long_id app = session->currentCall->appID
+        ) noexcept: AsceeError(code, msg, thrower), app(app) {}
+
+        /// writes the error as an http response into @p response without allocating memory.
         template<int size>
         auto& toHttpResponse(runtime::StringBuffer<size>& response) const {
+            char server[4 * sizeof(long_id)];
             response << "HTTP/1.1 " << errorCode() << " ";
             response << gReasonByStatusCode(code) << "\r\n";
-            response << "Server: " << app_trie_g.toDecimalStr(app) << "\r\n";
-            response << "Content-Length: " << (int) message.size() + 8 << "\r\n\r\n";
-            response << "Error: " << message << ".";
+            response << "Server: " << StringView(server, app_trie_g.toDecimal(app, server)) << "\r\n";
+            response << "Content-Length: " << (int) getMessage().size() + 8 << "\r\n\r\n";
+            response << "Error: " << getMessage() << ".";
             return response;
         }
 
@@ -196,26 +217,76 @@ public:
         CallContext();
 
         const long_id appID = 0;
+        /// the slot of the app in the dispatch table of the block. The root context does not have a slot.
+        const long slot = -1;
         bool hasLock = false;
-        std::vector<DeferredArgs> deferredCalls;
+        std::pmr::vector<DeferredArgs> deferredCalls{&session->skeleton->arena};
         CallContext* prevCallInfo = nullptr;
         jmp_buf env{};
+        /// a timeout of the caller that was pending when this call started. Pending timeouts are scoped per call,
+        /// so a timeout of the caller is never delivered to the callee, and vice versa.
+        bool callerPendingTimeout = false;
 
-        explicit CallContext(long_id app);
+        CallContext(long_id app, long slot);
 
         ~CallContext() noexcept;
     };
 
+    /// Reentrancy locks of apps, indexed by the slot of the app. All locks are released together by starting a new
+    /// generation.
+    class LockTable {
+    public:
+        [[nodiscard]]
+        bool isLocked(long slot) const { return locks[slot] == generation; }
+
+        void lock(long slot) { locks[slot] = generation; }
+
+        void unlock(long slot) { locks[slot] = 0; }
+
+        void reset(std::size_t slotCount) {
+            if (locks.size() < slotCount) locks.resize(slotCount, 0);
+            if (++generation == 0) {
+                std::fill(locks.begin(), locks.end(), 0);
+                generation = 1;
+            }
+        }
+
+    private:
+        std::vector<uint32_t> locks;
+        uint32_t generation = 0;
+    };
+
+    /// The parts of a session that are not bound to a request. A skeleton is reused for consecutive requests executed
+    /// by a worker.
+    struct SessionSkeleton {
+        static constexpr std::size_t arena_buffer_size = 16 * 1024;
+
+        ControlledCaller controlledCaller;
+        OptimisticCaller optimisticCaller;
+        InlineCaller inlineCaller;
+        LockTable lockTable;
+        alignas(std::max_align_t) byte arenaBuffer[arena_buffer_size];
+        /// The temporary allocations of a request are made from this arena, and they are released together before
+        /// the next request is executed.
+        std::pmr::monotonic_buffer_resource arena{arenaBuffer, arena_buffer_size};
+    };
+
     struct SessionInfo {
         AppRequest* request = nullptr;
-        bool guardedArea = false;
+        SessionSkeleton* skeleton = nullptr;
+        volatile bool guardedArea = false;
+        volatile bool pendingTimeout = false;
+        /// indicates that the current execution attempt is being abandoned, and timeouts should not be delivered.
+        volatile bool abandoned = false;
 
         HeapModifier& heapModifier = request->modifier;
         const AppTable& appTable = request->appTable;
         FailureManager& failureManager = request->failureManager;
-        std::unordered_map<uint64_t, bool> isLocked;
+        LockTable& lockTable = skeleton->lockTable;
         VirtualSignatureManager& sigManager = request->signatureManager;
-        std::unique_ptr<CallManager> callManager = nullptr;
+        CallManager* callManager = request->useControlledExecution ?
+                                   static_cast<CallManager*>(&skeleton->controlledCaller) :
+                                   static_cast<CallManager*>(&skeleton->optimisticCaller);
         //util::CryptoSystem& cryptoSigner;
 
         CallContext* currentCall = nullptr;
@@ -225,32 +296,60 @@ public:
     };
 
     /**
-     * instances of Executor should not be shared between different threads.
+     * instances of Executor should not be shared between different threads. The executor keeps responses in a
+     * private slab, which is reused by every call of the execute functions, hence a returned response is only valid
+     * until the next call.
      */
     Executor();
 
+    /// Creates an executor which stores the responses of requests in @p responseSlab.
+    explicit Executor(ResponseSlab& responseSlab);
+
     inline static SessionInfo* getSession() { return session; }
 
     /**
-     * The correct usage of this function is to use it at the start of the critical area and only call unGuard_() when the
+     * The correct usage of this function is to use it at the start of the critical area and only call unGuard() when the
      * code is completed normally. For example:
      * @code
      * int f() {
-     *     guardArea_();
+     *     guardArea();
      *
-     *     // no unGuard_ should be called here.
+     *     // no unGuard should be called here.
      *     throw std::exception();
      *
-     *     unGuard_();
+     *     unGuard();
      *     return 0;
      * }
+     *
+     * Guarding an area does not involve any system calls. If the cpu timer expires inside a guarded area, the
+     * timeout is postponed until unGuard() is called.
      */
-    static void guardArea() { session->callManager->guardArea_(); }
-
-    static void unGuard() { session->callManager->unGuard_(); }
+    static void guardArea() {
+        session->guardedArea = true;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+
+    static void unGuard() {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        session->guardedArea = false;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        if (session->pendingTimeout) deliverPendingTimeout();
+    }
 
     AppResponse executeOne(AppRequest* req);
 
+    /**
+     * Executes requests one after another in the calling thread. Unlike calling executeOne() for every request, a
+     * single session skeleton is used for the whole batch.
+     */
+    std::vector<AppResponse> executeBatch(std::span<AppRequest* const> requests);
+
+    /**
+     * Executes a request without writing its modifications to the heap. The modifications can be committed later by
+     * calling `req->modifier.writeToHeap()`.
+     */
+    AppResponse executeSpeculatively(AppRequest* req);
+
     static
     int callApp(byte forwarded_gas, long_id app_id, response_buffer_c& response, string_view_c request);
 
@@ -264,9 +363,22 @@ private:
 
     static void sig_handler(int sig, siginfo_t* info, void* ucontext);
 
+    static void deliverPendingTimeout();
+
     static void initHandlers();
 
-    static void* registerRecoveryStack();
+    std::unique_ptr<ResponseSlab> ownedSlab;
+    ResponseSlab* responseSlab = nullptr;
+
+    /// prepares the private slab of the executor for storing @p responseCount responses. It does nothing when the
+    /// executor uses an external slab.
+    void prepareOwnedSlab(std::size_t responseCount);
+
+    AppResponse execute(AppRequest* req, SessionSkeleton& skeleton, bool commit = true);
+
+    static void resetSession();
+
+    static void registerRecoveryStack();
 };
 
 } // namespace argennon::ascee::runtime
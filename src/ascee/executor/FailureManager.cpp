@@ -19,7 +19,6 @@
 #include "argc/types.h"
 
 #define MAX_CALL_DEPTH 16
-#define DEFAULT_STACK_SIZE (2*1024*1024)
 #define FAIL_CHECK_STACK_SIZE (1024*1024)
 #define DEFAULT_GAS_COEFFICIENT 300000
 #define FAIL_CHECK_GAS_COEFFICIENT 150000
@@ -48,7 +47,12 @@ size_t FailureManager::getStackSize(InvocationID id) {
         throw AsceeError("max call depth reached", StatusCode::limit_exceeded);
     }
     if (stackFailures.contains(id)) return FAIL_CHECK_STACK_SIZE;
-    return DEFAULT_STACK_SIZE;
+    return default_stack_size;
+}
+
+void FailureManager::reset() {
+    callDepth = 0;
+    lastGeneratedID = 0;
 }
 
 FailureManager::FailureManager(std::unordered_set<InvocationID> stackFailures,
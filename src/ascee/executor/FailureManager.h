@@ -27,6 +27,8 @@ class FailureManager {
 public:
     typedef int32_fast InvocationID;
 
+    static constexpr std::size_t default_stack_size = 2 * 1024 * 1024;
+
     FailureManager() = default;
 
     FailureManager(std::unordered_set<InvocationID> stackFailures,
@@ -40,6 +42,9 @@ public:
 
     size_t getStackSize(InvocationID id);
 
+    /// prepares the manager for executing its request from the beginning.
+    void reset();
+
 private:
     std::unordered_set<InvocationID> stackFailures;
     std::unordered_set<InvocationID> cpuTimeFailures;
@@ -0,0 +1,47 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <sys/mman.h>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "ResponseSlab.h"
+
+using namespace argennon::ascee::runtime;
+
+ResponseSlab::ResponseSlab(std::size_t capacity) : capacity(capacity) {
+    // mmap does not accept zero length mappings.
+    if (capacity == 0) throw std::invalid_argument("response slab capacity must be positive");
+    void* mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) throw std::runtime_error(std::to_string(errno) + ": response slab allocation failed");
+    base = static_cast<char*>(mapping);
+}
+
+ResponseSlab::~ResponseSlab() noexcept {
+    munmap(base, capacity);
+}
+
+std::string_view ResponseSlab::store(std::string_view response) {
+    // space is reserved only when it is available, so a rejected response does not consume any space.
+    auto offset = used.load(std::memory_order_relaxed);
+    do {
+        if (response.size() > capacity - offset) throw std::length_error("response slab is full");
+    } while (!used.compare_exchange_weak(offset, offset + response.size(), std::memory_order_relaxed));
+    std::memcpy(base + offset, response.data(), response.size());
+    return {base + offset, response.size()};
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ARGENNON_RESPONSE_SLAB_H
+#define ARGENNON_RESPONSE_SLAB_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include "argc/types.h"
+
+namespace argennon::ascee::runtime {
+
+/**
+ * A contiguous memory region for keeping the responses of the requests of a block. Workers copy their responses
+ * directly into the slab, so a block does not need a separate heap allocation for every response.
+ *
+ * The memory is reserved using a single NORESERVE mapping, hence physical pages are only used for the bytes that
+ * are actually written.
+ */
+class ResponseSlab {
+public:
+    static constexpr std::size_t max_response_size = sizeof(response_buffer_c);
+
+    /// @param capacity is the size of the slab in bytes, which must be positive.
+    explicit ResponseSlab(std::size_t capacity);
+
+    ResponseSlab(const ResponseSlab&) = delete;
+
+    ~ResponseSlab() noexcept;
+
+    /**
+     * Copies @p response into the slab.
+     * @note This function is thread-safe.
+     * @return a view of the copied response which is valid until the slab is reset or destroyed.
+     */
+    std::string_view store(std::string_view response);
+
+    /**
+     * Discards all stored responses, so the whole capacity of the slab can be reused. Views returned by store() are
+     * not valid after calling this function.
+     * @note This function is not thread-safe, and must not be called concurrently with store().
+     */
+    void reset() { used = 0; }
+
+    /// returns all stored responses as a single contiguous view, in the order they were stored.
+    [[nodiscard]]
+    std::string_view getContent() const { return {base, used.load()}; }
+
+    [[nodiscard]]
+    std::size_t getCapacity() const { return capacity; }
+
+private:
+    char* base;
+    std::size_t capacity;
+    std::atomic<std::size_t> used = 0;
+};
+
+} // namespace argennon::ascee::runtime
+#endif // ARGENNON_RESPONSE_SLAB_H
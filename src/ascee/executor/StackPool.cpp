@@ -0,0 +1,65 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <sys/mman.h>
+#include <stdexcept>
+#include <string>
+#include "StackPool.h"
+
+using namespace argennon::ascee::runtime;
+
+StackPool::Stack StackPool::acquire(std::size_t stackSize) {
+    for (auto it = freeStacks.rbegin(); it != freeStacks.rend(); ++it) {
+        if (it->size == stackSize) {
+            auto* mapping = it->mapping;
+            freeStacks.erase(std::next(it).base());
+            return {this, mapping, stackSize};
+        }
+    }
+
+    void* mapping = mmap(nullptr, stackSize + guard_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (mapping == MAP_FAILED) throw std::runtime_error(std::to_string(errno) + ": stack allocation failed");
+
+    // stacks grow downward, so the guard region must be at the lowest address of the mapping.
+    if (mprotect(mapping, guard_size, PROT_NONE) != 0) {
+        munmap(mapping, stackSize + guard_size);
+        throw std::runtime_error(std::to_string(errno) + ": could not protect the stack guard");
+    }
+    return {this, static_cast<std::byte*>(mapping), stackSize};
+}
+
+void StackPool::release(std::byte* mapping, std::size_t size) {
+    freeStacks.push_back({mapping, size});
+}
+
+StackPool::~StackPool() noexcept {
+    for (const auto& stack: freeStacks) munmap(stack.mapping, stack.size + guard_size);
+}
+
+StackPool& StackPool::local() {
+    static thread_local StackPool pool;
+    return pool;
+}
+
+StackPool::Stack::Stack(StackPool::Stack&& other) noexcept: pool(other.pool), mapping(other.mapping), size(other.size) {
+    other.mapping = nullptr;
+}
+
+StackPool::Stack::~Stack() noexcept {
+    if (mapping != nullptr) pool->release(mapping, size);
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ARGENNON_STACK_POOL_H
+#define ARGENNON_STACK_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+namespace argennon::ascee::runtime {
+
+/**
+ * A per-thread pool of memory mapped stacks for running dispatchers as fibers. Every stack has a PROT_NONE guard
+ * region below it, so a stack overflow raises SIGSEGV like it would for a normal thread stack.
+ *
+ * Stacks are not returned to the OS until the owner thread exits, which lets nested calls of consecutive requests
+ * reuse the same mappings.
+ */
+class StackPool {
+public:
+    static constexpr std::size_t guard_size = 64 * 1024;
+
+    class Stack {
+    public:
+        Stack(Stack&& other) noexcept;
+
+        Stack(const Stack&) = delete;
+
+        ~Stack() noexcept;
+
+        [[nodiscard]] void* getBase() const { return mapping + guard_size; }
+
+        [[nodiscard]] std::size_t getSize() const { return size; }
+
+    private:
+        friend class StackPool;
+
+        Stack(StackPool* pool, std::byte* mapping, std::size_t size) : pool(pool), mapping(mapping), size(size) {}
+
+        StackPool* pool;
+        std::byte* mapping;
+        std::size_t size;
+    };
+
+    StackPool() = default;
+
+    StackPool(const StackPool&) = delete;
+
+    ~StackPool() noexcept;
+
+    Stack acquire(std::size_t stackSize);
+
+    static StackPool& local();
+
+private:
+    struct FreeStack {
+        std::byte* mapping;
+        std::size_t size;
+    };
+
+    std::vector<FreeStack> freeStacks;
+
+    void release(std::byte* mapping, std::size_t size);
+};
+
+} // namespace argennon::ascee::runtime
+
+#endif // ARGENNON_STACK_POOL_H
@@ -27,17 +27,18 @@ using std::string;
 const std::size_t VirtualSignatureManager::SIG_CONSTANT_COST;
 const std::size_t VirtualSignatureManager::MAX_COST;
 
-int32_fast VirtualSignatureManager::sign(std::string msg, long_id issuer) {
-    // here the msg will be copies and saved inside messages
+int32_fast VirtualSignatureManager::sign(std::string_view msg, long_id issuer) {
+    // here the msg will be copied and saved inside messageBuffer
     cost += msg.size() + SIG_CONSTANT_COST;
     if (cost > MAX_COST) throw AsceeError("too many virtual signatures", StatusCode::limit_exceeded);
-    messages.emplace_back(SignedMessage{issuer, std::move(msg)});
-    return int32_fast(messages.size()) - 1;
+    add(msg, issuer);
+    return int32_fast(signatures.size()) - 1;
 }
 
 bool VirtualSignatureManager::verifyAndInvalidate(std::string_view msg, long_id issuer, int32_fast index) {
     if (verify(msg, issuer, index)) {
-        messages[index].message = "";
+        // the message is kept, so we can restore the signature if the request is executed again.
+        signatures[index].invalidated = true;
         cost -= msg.size() + SIG_CONSTANT_COST;
         return true;
     }
@@ -46,12 +47,28 @@ bool VirtualSignatureManager::verifyAndInvalidate(std::string_view msg, long_id
 
 VirtualSignatureManager::VirtualSignatureManager(
         std::vector<SignedMessage>&& messages
-) : messages(std::move(messages)) {}
+) : initialCount(messages.size()) {
+    signatures.reserve(messages.size());
+    for (const auto& msg: messages) add(msg.message, msg.issuerAccount);
+    initialBufferSize = messageBuffer.size();
+}
+
+void VirtualSignatureManager::add(std::string_view msg, long_id issuer) {
+    signatures.emplace_back(Signature{issuer, uint32(messageBuffer.size()), uint32(msg.size())});
+    messageBuffer.append(msg);
+}
+
+void VirtualSignatureManager::reset() {
+    signatures.erase(signatures.begin() + long(initialCount), signatures.end());
+    messageBuffer.resize(initialBufferSize);
+    for (auto& sig: signatures) sig.invalidated = false;
+    cost = 0;
+}
 
 bool VirtualSignatureManager::verify(std::string_view msg, long_id issuer, int32_fast index) {
     try {
-        const auto& sig = messages.at(index);
-        return sig.message == msg && sig.issuerAccount == issuer;
+        const auto& sig = signatures.at(index);
+        return !sig.invalidated && getMessage(sig) == msg && sig.issuerAccount == issuer;
     } catch (const std::out_of_range&) {
         return false;
     }
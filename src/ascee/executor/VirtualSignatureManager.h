@@ -30,21 +30,44 @@ public:
     struct SignedMessage {
         long_id issuerAccount;
         std::string message;
+        bool invalidated = false;
     };
     static const std::size_t SIG_CONSTANT_COST = 8;
     static const std::size_t MAX_COST = 128 * 1024;
 
     explicit VirtualSignatureManager(std::vector<SignedMessage>&& messages);
 
-    int32_fast sign(std::string msg, long_id issuer);
+    int32_fast sign(std::string_view msg, long_id issuer);
 
     bool verify(std::string_view msg, long_id issuer, int32_fast index);
 
     bool verifyAndInvalidate(std::string_view msg, long_id issuer, int32_fast index);
 
+    /// removes virtual signatures and restores signatures invalidated since the creation of the manager.
+    void reset();
+
 private:
+    /// a signature refers to its message by its position in `messageBuffer`.
+    struct Signature {
+        long_id issuerAccount;
+        uint32 offset;
+        uint32 size;
+        bool invalidated = false;
+    };
+
     std::size_t cost = 0;
-    std::vector<SignedMessage> messages;
+    std::size_t initialCount;
+    std::size_t initialBufferSize;
+    std::vector<Signature> signatures;
+    /// Messages are appended to a single buffer, so signing a message usually does not need any allocation.
+    std::string messageBuffer;
+
+    [[nodiscard]]
+    std::string_view getMessage(const Signature& sig) const {
+        return std::string_view(messageBuffer).substr(sig.offset, sig.size);
+    }
+
+    void add(std::string_view msg, long_id issuer);
 };
 
 } // namespace argennon::ascee::runtime
@@ -15,24 +15,30 @@
 // You should have received a copy of the GNU Affero General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <bit>
 #include <cstring>
 #include <sstream>
 #include <cassert>
+#include <cstdint>
 #include "Chunk.h"
+#include "ChunkAllocator.h"
 #include "util/PrefixTrie.hpp"
 
 using namespace argennon;
 using namespace argennon::ascee::runtime;
 using namespace util;
-using std::unique_ptr, std::make_unique;
 
 /// new chunks always have a size of zero. Their size usually should be changed by using reSize() function.
 /// The chunk will be zero initialized. This is important to make sure that smart contracts
 /// behave deterministically and validators will agree on the result of executing a smart contact.
-Chunk::Chunk(uint capacity) : chunkSize(0), capacity(capacity) {
+Chunk::Chunk(uint capacity) : chunkSize(0), capacity(capacity), slotSize(ChunkAllocator::slotSize(capacity)) {
     assert(capacity <= maxAllowedCapacity);
-    content = make_unique<byte[]>(capacity);
-    // arrays created by make_unique are value initialized.
+    content = ChunkAllocator::global().allocate(capacity);
+    if (slotSize > 0) memset(content, 0, slotSize);
+}
+
+Chunk::~Chunk() noexcept {
+    ChunkAllocator::global().deallocate(content, slotSize);
 }
 
 uint32 Chunk::getsize() const {
@@ -41,7 +47,7 @@ uint32 Chunk::getsize() const {
 
 Chunk::Pointer Chunk::getContentPointer(uint32 offset, uint32 size) {
     if (int64(offset) + int64(size) > int64(capacity)) throw std::out_of_range("out of allocated memory range");
-    return {content.get() + offset, size};
+    return {content + offset, size};
 }
 
 Chunk* Chunk::setWritable(bool wr) {
@@ -54,19 +60,38 @@ void Chunk::setSize(uint32 newSize) {
 
     // Based on specs offsets beyond chunkSize must be zero initialised at the start of every execution session.
     if (newSize < chunkSize) {
-        memset(content.get() + newSize, 0, chunkSize - newSize);
+        memset(content + newSize, 0, chunkSize - newSize);
+        markModified(newSize, chunkSize);
     }
 
     chunkSize = newSize;
 }
 
 void Chunk::resize(uint32 newCapacity) {
+    auto& allocator = ChunkAllocator::global();
+    auto* newContent = allocator.allocate(newCapacity);
+    auto newSlotSize = ChunkAllocator::slotSize(newCapacity);
+    if (chunkSize > 0) memcpy(newContent, content, chunkSize);
     // we need to zero initialize the empty part of the memory.
-    auto* newContent = new byte[newCapacity];
-    memcpy(newContent, content.get(), chunkSize);
-    if (newCapacity > chunkSize) memset(newContent + chunkSize, 0, newCapacity - chunkSize);
-    content.reset(newContent);
+    if (newSlotSize > chunkSize) memset(newContent + chunkSize, 0, newSlotSize - chunkSize);
+    allocator.deallocate(content, slotSize);
+    content = newContent;
+    slotSize = newSlotSize;
+    setCapacity(newCapacity);
+}
+
+void Chunk::setCapacity(uint32 newCapacity) {
+    auto oldShift = granuleShift();
     capacity = newCapacity;
+    // recorded granules are not valid with the new granule size, so we conservatively mark the whole chunk.
+    if (granuleShift() != oldShift && modifiedGranules.load(std::memory_order_relaxed) != 0) {
+        modifiedGranules = ~uint64_t(0);
+    }
+}
+
+int Chunk::granuleShift() const {
+    // 64 granules must cover the whole capacity.
+    return capacity <= 64 ? 0 : std::bit_width(capacity - 1) - 6;
 }
 
 bool Chunk::reserveSpace(uint32 newCapacity) {
@@ -74,13 +99,19 @@ bool Chunk::reserveSpace(uint32 newCapacity) {
 
     if (newCapacity <= capacity) return false;
 
-    resize(newCapacity);
+    // the slot is zero after chunkSize, so when it is large enough the chunk can grow in place.
+    if (newCapacity <= slotSize) setCapacity(newCapacity);
+    else resize(newCapacity);
     return true;
 }
 
 bool Chunk::shrinkSpace() {
     if (chunkSize == capacity) return false;
-    resize(chunkSize);
+    memset(content + chunkSize, 0, capacity - chunkSize);
+    // For having some hysteresis, the slot is only replaced when it is at least four times larger than needed.
+    // Otherwise, a chunk which is expanded and shrunk in every block would be reallocated in every block.
+    if (slotSize >= 4 * ChunkAllocator::slotSize(chunkSize)) resize(chunkSize);
+    else setCapacity(chunkSize);
     return true;
 }
 
@@ -115,13 +146,93 @@ void Chunk::applyDelta(const byte*& delta, const byte* boundary) {
             else break;
         }
 
-        memcpy(content.get() + offset, delta, blockSize);
+        memcpy(content + offset, delta, blockSize);
+        markStale(offset, offset + blockSize);
         delta += blockSize;
         offset += blockSize;
     }
     chunkSize = size;
     // important!
     shrinkSpace();
+    // the chunk is now in sync with the source of the delta.
+    deltaBaseSize = size;
+    modifiedGranules = 0;
+}
+
+void Chunk::markModified(uint32 begin, uint32 end) {
+    end = std::min(end, capacity);
+    if (begin >= end) return;
+    markStale(begin, end);
+    auto shift = granuleShift();
+    auto first = begin >> shift;
+    auto count = ((end - 1) >> shift) - first + 1;
+    uint64_t bits = (count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1) << first;
+    // Checking the mask first avoids writing to a shared cache line when the granules are already marked. This is
+    // important for popular chunks which are modified by many requests in parallel.
+    if ((modifiedGranules.load(std::memory_order_relaxed) & bits) != bits) {
+        modifiedGranules.fetch_or(bits, std::memory_order_relaxed);
+    }
+}
+
+void Chunk::markStale(uint32 begin, uint32 end) {
+    if (begin >= end) return;
+    auto first = begin / digest_segment_size;
+    auto count = (end - 1) / digest_segment_size - first + 1;
+    uint64_t bits = (count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1) << first;
+    if ((staleSegments.load(std::memory_order_relaxed) & bits) != bits) {
+        staleSegments.fetch_or(bits, std::memory_order_relaxed);
+    }
+}
+
+Digest Chunk::calculateDigest() {
+    uint32 size = chunkSize;
+    auto segmentCount = (size + digest_segment_size - 1) / digest_segment_size;
+    uint64_t stale = staleSegments.exchange(0, std::memory_order_relaxed);
+
+    uint32 first;
+    if (size != digestedSize || segmentStates.empty()) {
+        // the size is the first input of the digest, so when it is changed no saved state can be reused.
+        segmentStates.resize(segmentCount + 1);
+        segmentStates[0] = DigestCalculator();
+        segmentStates[0] << int32(size);
+        digestedSize = size;
+        first = 0;
+    } else {
+        first = std::min(uint32(std::countr_zero(stale)), segmentCount);
+    }
+
+    for (uint32 i = first; i < segmentCount; ++i) {
+        auto begin = i * digest_segment_size;
+        segmentStates[i + 1] = segmentStates[i];
+        segmentStates[i + 1].append(content + begin, std::min(digest_segment_size, size - begin));
+    }
+    auto calculator = segmentStates[segmentCount];
+    return calculator.CalculateDigest();
+}
+
+void Chunk::writeDelta(std::vector<byte>& delta, bool full) {
+    uint64_t mask = modifiedGranules.exchange(0, std::memory_order_relaxed);
+    if (full) mask = ~uint64_t(0);
+    uint32 size = chunkSize;
+    var_uint_trie_g.appendVarUInt(delta, size ^ (full ? 0 : deltaBaseSize));
+
+    auto shift = granuleShift();
+    uint32 last = 0;
+    while (mask != 0) {
+        int first = std::countr_zero(mask);
+        int count = std::countr_one(mask >> first);
+        mask = first + count == 64 ? 0 : mask & (~uint64_t(0) << (first + count));
+        uint32 begin = uint32(first) << shift;
+        uint32 end = std::min(uint32(first + count) << shift, size);
+        // granules are sorted, so the remaining granules are outside the chunk too.
+        if (begin >= end) break;
+        var_uint_trie_g.appendVarUInt(delta, begin - last + 1);
+        var_uint_trie_g.appendVarUInt(delta, end - begin);
+        delta.insert(delta.end(), content + begin, content + end);
+        last = end;
+    }
+    var_uint_trie_g.appendVarUInt(delta, 0);
+    deltaBaseSize = size;
 }
 
 bool Chunk::isWritable() const {
@@ -129,7 +240,17 @@ bool Chunk::isWritable() const {
 }
 
 std::mutex& Chunk::getContentMutex() {
-    return contentMutex;
+    // A mutex for every chunk would cost 40 bytes per chunk, while contention is rare. Instead, we use a fixed table
+    // of mutexes. Each mutex is placed on its own cache line to avoid false sharing.
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+    };
+    constexpr std::size_t stripe_count = 256;
+    static Stripe stripes[stripe_count];
+    auto hash = reinterpret_cast<std::uintptr_t>(this);
+    hash ^= hash >> 17;
+    hash *= 0x9e3779b97f4a7c15;
+    return stripes[(hash >> 32) % stripe_count].mutex;
 }
 
 Chunk::operator std::string() const {
@@ -23,6 +23,7 @@
 #include <memory>
 #include <atomic>
 #include <mutex>
+#include <vector>
 
 namespace argennon::ascee::runtime {
 
@@ -54,6 +55,8 @@ public:
 
     Chunk(const Chunk&) = delete;
 
+    ~Chunk() noexcept;
+
     explicit operator std::string() const;
 
     [[nodiscard]]
@@ -67,29 +70,48 @@ public:
     /// This function should only be called at the end of block validation.
     bool shrinkSpace();
 
+    /**
+     * Calculates the digest of the size and the content of the chunk. The state of the digest calculator at the start
+     * of every fixed size segment of the content is saved, so only the content after the first segment modified
+     * since the last call is rehashed.
+     *
+     * This function must not be called concurrently with modifying the chunk.
+     */
     [[nodiscard]]
-    Digest calculateDigest() const {
-        DigestCalculator calculator;
-        calculator << int32(chunkSize);
-        calculator.append(content.get(), chunkSize);
-        return calculator.CalculateDigest();
-    };
+    Digest calculateDigest();
 
     [[nodiscard]]
     bool isWritable() const;;
 
     Pointer getContentPointer(uint32 offset, uint32 size);
 
+    /// returns the mutex protecting the content of this chunk. Mutexes are taken from a striped table, so different
+    /// chunks may share the same mutex.
     std::mutex& getContentMutex();
 
     void applyDelta(const byte*& delta, const byte* boundary);
 
+    /// records that the range [begin, end) of the chunk content was modified. Modified ranges are used for creating
+    /// deltas and updating the digest of the chunk. This function is thread-safe and lock-free.
+    void markModified(uint32 begin, uint32 end);
+
+    /**
+     * Appends a delta to @p delta, in the format accepted by applyDelta(). The delta contains the modifications
+     * recorded by markModified() since the last delta was created or applied. When @p full is true the delta
+     * contains the whole chunk and can be applied to an empty chunk.
+     *
+     * The modified ranges are tracked with a fixed number of granules per chunk, so a delta may contain some
+     * unmodified bytes around the modified ranges.
+     */
+    void writeDelta(std::vector<byte>& delta, bool full = false);
+
     /// This is used to indicate that a chunk will not be modified in a block. Knowing that a chunk is not modified
     /// in the block helps in efficient calculation of commitments.
     Chunk* setWritable(bool writable);
 
 private:
-    std::unique_ptr<byte[]> content;
+    /// the content is allocated from ChunkAllocator. All bytes of the slot after chunkSize are always zero.
+    byte* content = nullptr;
     // chunkSize must be atomic because there is a possibility for concurrent access. This could happen when for example
     // the chunk is going to be expanded and at the same time a request wants to check the validity of locations inside
     // old boundaries of the chunk.
@@ -97,10 +119,30 @@ private:
     // chunkSize to be run concurrently. but concurrent writes can not happen.
     std::atomic<uint32> chunkSize = 0;
     uint32 capacity = 0;
+    uint32 slotSize = 0;
+    /// the size of the chunk when the last delta was created or applied.
+    uint32 deltaBaseSize = 0;
+    /// every bit of this mask indicates that a granule of the content was modified. The size of granules depends on
+    /// the capacity of the chunk, see granuleShift().
+    std::atomic<uint64_t> modifiedGranules = 0;
     bool writable = true;
-    std::mutex contentMutex;
+
+    static constexpr uint32 digest_segment_size = maxAllowedCapacity / 64;
+    /// segmentStates[i] is the state of the digest calculator before the i-th segment of the content was appended.
+    /// A state is valid only if no segment before it is marked in staleSegments.
+    std::vector<DigestCalculator> segmentStates;
+    /// the size of the chunk when segmentStates were calculated.
+    uint32 digestedSize = 0;
+    std::atomic<uint64_t> staleSegments = 0;
 
     void resize(uint32 newCapacity);
+
+    void setCapacity(uint32 newCapacity);
+
+    [[nodiscard]]
+    int granuleShift() const;
+
+    void markStale(uint32 begin, uint32 end);
 };
 
 } // namespace argennon::ascee::runtime::heap
@@ -0,0 +1,160 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include "ChunkAllocator.h"
+
+using namespace argennon;
+using namespace argennon::ascee::runtime;
+
+int ChunkAllocator::classOf(uint32 size) {
+    assert(size > 0 && size <= max_slot_size);
+    if (size <= min_slot_size) return 0;
+    return std::bit_width(size - 1) - std::bit_width(min_slot_size - 1);
+}
+
+uint32 ChunkAllocator::slotSize(uint32 size) {
+    if (size == 0) return 0;
+    return min_slot_size << classOf(size);
+}
+
+struct ChunkAllocator::ThreadCache {
+    struct Bin {
+        FreeSlot* head = nullptr;
+        uint32 count = 0;
+    };
+
+    std::array<Bin, class_count> bins{};
+    /// is set when the thread is exiting and its cached slots are released. After that, slots are not cached anymore.
+    bool released = false;
+};
+
+/// returns the cached slots of a thread to the shared free lists when the thread exits.
+struct ChunkAllocator::CacheRelease {
+    ThreadCache* cache;
+
+    ~CacheRelease() {
+        for (int i = 0; i < class_count; ++i) global().flush(i, *cache, cache->bins[i].count);
+        cache->released = true;
+    }
+};
+
+uint32 ChunkAllocator::batchSize(int classIndex) {
+    return std::clamp<uint32>(batch_bytes / (min_slot_size << classIndex), 1, max_batch_slots);
+}
+
+ChunkAllocator::ThreadCache& ChunkAllocator::localCache() {
+    // ThreadCache is trivially destructible, so it can still be used by chunks which are destructed after
+    // CacheRelease, for example chunks with static storage duration.
+    static thread_local ThreadCache cache;
+    static thread_local CacheRelease release{&cache};
+    return *release.cache;
+}
+
+byte* ChunkAllocator::allocate(uint32 size) {
+    if (size == 0) return nullptr;
+    auto index = classOf(size);
+    auto& cache = localCache();
+    auto& bin = cache.bins[index];
+    if (bin.head == nullptr) refill(index, cache);
+
+    auto* result = bin.head;
+    bin.head = result->next;
+    --bin.count;
+    return reinterpret_cast<byte*>(result);
+}
+
+void ChunkAllocator::deallocate(byte* slot, uint32 size) {
+    if (slot == nullptr) return;
+    auto index = classOf(size);
+    auto& cache = localCache();
+    auto& bin = cache.bins[index];
+    bin.head = new(slot) FreeSlot{bin.head};
+    ++bin.count;
+
+    if (cache.released) flush(index, cache, bin.count);
+    else if (bin.count > 2 * batchSize(index)) flush(index, cache, batchSize(index));
+}
+
+void ChunkAllocator::refill(int classIndex, ThreadCache& cache) {
+    auto& sizeClass = classes[classIndex];
+    auto& bin = cache.bins[classIndex];
+    uint32 slot = min_slot_size << classIndex;
+    auto count = cache.released ? 1 : batchSize(classIndex);
+
+    std::lock_guard<std::mutex> lock(sizeClass.mutex);
+    for (uint32 i = 0; i < count; ++i) {
+        FreeSlot* freeSlot = sizeClass.freeList;
+        if (freeSlot != nullptr) {
+            sizeClass.freeList = freeSlot->next;
+        } else {
+            if (sizeClass.regionPos == sizeClass.regionEnd) {
+                sizeClass.regionPos = mapRegion();
+                sizeClass.regionEnd = sizeClass.regionPos + region_size;
+            }
+            freeSlot = reinterpret_cast<FreeSlot*>(sizeClass.regionPos);
+            sizeClass.regionPos += slot;
+        }
+        freeSlot->next = bin.head;
+        bin.head = freeSlot;
+    }
+    bin.count += count;
+}
+
+void ChunkAllocator::flush(int classIndex, ThreadCache& cache, uint32 count) {
+    auto& bin = cache.bins[classIndex];
+    assert(count <= bin.count);
+    if (count == 0) return;
+
+    // the first `count` slots of the bin are detached and spliced into the shared free list with a single lock.
+    FreeSlot* first = bin.head;
+    FreeSlot* last = first;
+    for (uint32 i = 1; i < count; ++i) last = last->next;
+    bin.head = last->next;
+    bin.count -= count;
+
+    auto& sizeClass = classes[classIndex];
+    std::lock_guard<std::mutex> lock(sizeClass.mutex);
+    last->next = sizeClass.freeList;
+    sizeClass.freeList = first;
+}
+
+byte* ChunkAllocator::mapRegion() {
+    // Explicit huge pages are only available when the system has reserved them. Otherwise, we use normal pages and
+    // ask the kernel to back the region with transparent huge pages. MAP_NORESERVE must not be used with huge pages,
+    // because then mmap succeeds without reserved pages, and we will get a SIGBUS when the region is touched.
+    void* mapping = mmap(nullptr, region_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED) throw std::runtime_error(std::to_string(errno) + ": chunk region allocation failed");
+        madvise(mapping, region_size, MADV_HUGEPAGE);
+    }
+    return static_cast<byte*>(mapping);
+}
+
+ChunkAllocator& ChunkAllocator::global() {
+    // The allocator is never destructed, so chunks with static storage duration can be safely destructed at exit.
+    static auto* allocator = new ChunkAllocator();
+    return *allocator;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ARGENNON_CHUNK_ALLOCATOR_H
+#define ARGENNON_CHUNK_ALLOCATOR_H
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include "core/primitives.h"
+
+namespace argennon::ascee::runtime {
+
+/**
+ * Allocates the content of chunks from size-class slabs. Every size class is a power of two, and slots of a class are
+ * carved from large regions that are mapped using huge pages when possible.
+ *
+ * Every thread keeps a small cache of free slots for each class, so most allocations and deallocations do not need
+ * any synchronization. The shared free list of a class is only locked when a thread cache is refilled or flushed,
+ * and then a batch of slots is moved at once.
+ *
+ * Retention policy: regions are never unmapped, so the memory of the allocator is bounded by the peak memory used
+ * by chunks. A freed slot is kept in the cache of the thread that freed it, until the cache of its class is full,
+ * and then a batch of slots is returned to the shared free list of the class. When a thread exits, all slots of its
+ * cache are returned to the shared free lists.
+ *
+ * Most chunks are small, so allocating them from slabs avoids the overhead of malloc and keeps them densely packed
+ * in a few huge pages, which reduces TLB misses.
+ *
+ * @note All functions of this class are thread-safe.
+ */
+class ChunkAllocator {
+public:
+    static constexpr uint32 min_slot_size = 16;
+    static constexpr uint32 max_slot_size = 64 * 1024;
+    static constexpr std::size_t region_size = 2 * 1024 * 1024;
+
+    ChunkAllocator(const ChunkAllocator&) = delete;
+
+    /// returns the size of the slot that will be allocated for @p size bytes. For zero it returns zero.
+    static uint32 slotSize(uint32 size);
+
+    /// allocates a slot of slotSize(size) bytes. The content of the slot is not initialized. For zero it returns
+    /// nullptr.
+    byte* allocate(uint32 size);
+
+    /// returns a slot to the allocator. @p size can be the size which was used for allocating the slot, or any size
+    /// with the same slot size. The slot can be deallocated by any thread.
+    void deallocate(byte* slot, uint32 size);
+
+    static ChunkAllocator& global();
+
+private:
+    static constexpr int class_count = 13;
+    static_assert(min_slot_size << (class_count - 1) == max_slot_size);
+    /// the number of bytes that are moved between a thread cache and the shared free list of a class at once.
+    static constexpr uint32 batch_bytes = 64 * 1024;
+    static constexpr uint32 max_batch_slots = 32;
+
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    struct SizeClass {
+        std::mutex mutex;
+        FreeSlot* freeList = nullptr;
+        byte* regionPos = nullptr;
+        byte* regionEnd = nullptr;
+    };
+
+    struct ThreadCache;
+    struct CacheRelease;
+
+    std::array<SizeClass, class_count> classes;
+
+    // thread caches are only kept for the global allocator.
+    ChunkAllocator() = default;
+
+    static int classOf(uint32 size);
+
+    static uint32 batchSize(int classIndex);
+
+    static ThreadCache& localCache();
+
+    void refill(int classIndex, ThreadCache& cache);
+
+    void flush(int classIndex, ThreadCache& cache, uint32 count);
+
+    static byte* mapRegion();
+};
+
+} // namespace argennon::ascee::runtime
+#endif // ARGENNON_CHUNK_ALLOCATOR_H
@@ -17,7 +17,10 @@
 
 #include "RestrictedModifier.h"
 #include "argc/types.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <charconv>
 #include <utility>
 
 
@@ -32,15 +35,53 @@ using Access = AccessBlockInfo::Access;
 
 constexpr uint32 max_chunk_size = 64 * 1024;
 
+static inline
+void checkAccess(Chunk* chunk, const AccessBlockInfo& info) {
+    if (info.accessType.mayWrite() && !chunk->isWritable()) {
+        throw BlockError("trying to modify a readonly chunk");
+    }
+    if (info.accessType == Access::Type::float_additive && info.size != sizeof(float64)) {
+        throw BlockError("float additive blocks must be 8 bytes");
+    }
+}
+
+static inline
+std::size_t alignedSize(std::size_t size) {
+    constexpr auto alignment = alignof(std::max_align_t);
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static const std::out_of_range undefined_access_block("no access block is defined");
+
+RestrictedModifier::AccessError::AccessError(uint32 offset) noexcept: std::out_of_range(undefined_access_block) {
+    constexpr std::string_view prefix = "no access block is defined at offset: ";
+    prefix.copy(message, prefix.size());
+    *std::to_chars(message + prefix.size(), message + sizeof(message) - 1, offset).ptr = 0;
+}
+
 
 int16_t RestrictedModifier::saveVersion() {
-    if (currentVersion == MAX_VERSION) throw AsceeError("version limit reached", StatusCode::limit_exceeded);
-    return currentVersion++;
+    if (undoLog.getMarkCount() == MAX_VERSION) {
+        throw AsceeError("version limit reached", StatusCode::limit_exceeded);
+    }
+    undoLog.mark();
+    return int16_t(undoLog.getMarkCount() - 1);
 }
 
 void RestrictedModifier::restoreVersion(int16_t version) {
-    assert(version < currentVersion && version >= 0);
-    currentVersion = version;
+    assert(version >= 0);
+    undoLog.undo(version);
+}
+
+void RestrictedModifier::reset() {
+    for (auto& chunk: table.getChunks()) {
+        for (auto i = chunk.firstBlock; i < chunk.endBlock; ++i) table.blocks[i].reset();
+        chunk.reset();
+    }
+    currentChunk = nullptr;
+    currentApp = nullptr;
+    // all blocks were reset, so their working copies can be released.
+    undoLog.clear();
 }
 
 void RestrictedModifier::loadChunk(long_id localID) {
@@ -48,48 +89,60 @@ void RestrictedModifier::loadChunk(long_id localID) {
 }
 
 void RestrictedModifier::loadChunk(long_id accountID, long_id localID) {
-    try {
-        currentChunk = &chunks->at({accountID, localID});
-    } catch (const std::out_of_range&) {
-        throw std::out_of_range("chunk[" + (std::string) accountID + "." + (std::string) localID + "] is not defined");
+    long_long_id chunkID(accountID, localID);
+    if (currentApp != nullptr) {
+        auto end = table.chunks + currentApp->endChunk;
+        auto chunk = std::lower_bound(table.chunks + currentApp->firstChunk, end, chunkID,
+                                      [](const ChunkEntry& entry, const long_long_id& id) { return entry.id < id; });
+        if (chunk != end && chunk->id == chunkID) {
+            currentChunk = chunk;
+            return;
+        }
     }
+    throw std::out_of_range("chunk[" + (std::string) accountID + "." + (std::string) localID + "] is not defined");
 }
 
 void RestrictedModifier::loadContext(long_id appID) {
-    // When `appID` does not exist in the map, this function should not throw an exception. Smart contracts do not
+    // When `appID` does not exist in the table, this function should not throw an exception. Smart contracts do not
     // call this function directly and failing can be problematic for `invoke_dispatcher` function.
-    try {
-        chunks = &appsAccessMaps.at(appID);
-    } catch (const std::out_of_range&) {
-        chunks = nullptr;
-    }
+    auto apps = table.getApps();
+    auto app = std::lower_bound(apps.begin(), apps.end(), appID,
+                                [](const AppEntry& entry, const long_id& id) { return entry.id < id; });
+    currentApp = app != apps.end() && app->id == appID ? &*app : nullptr;
     currentChunk = nullptr;
 }
 
 void RestrictedModifier::writeToHeap() {
-    if (currentVersion == 0) return;
-
-    for (auto& appMap: appsAccessMaps.getValues()) {
-        for (auto& chunk: appMap.getValues()) {
-            auto chunkSize = chunk.sizeBlock().read<uint32>(currentVersion, 0);
-            if (chunk.resizing == ChunkInfo::ResizingType::expandable ||
-                chunk.resizing == ChunkInfo::ResizingType::shrinkable) {
-                chunk.ptr->setSize(chunkSize);
-            }
-            if (chunkSize > 0 && chunk.ptr->isWritable()) {
-                for (long i = 0; i < chunk.accessTable.size(); ++i) {
-                    auto offset = chunk.accessTable.getKeys()[i];
-                    if (offset >= chunkSize) break;     // since offsets are sorted.
-                    // We should make sure that we never write outside the chunk.
-                    chunk.accessTable.getValues()[i].wrToHeap(chunk.ptr, currentVersion, chunkSize - offset);
-                }
-            }
+    auto& modifiedBlocks = undoLog.getModifiedBlocks();
+    // In speculative mode a lock is held for every write, so a snapshot never observes a partially written block or
+    // a shrunk chunk whose tail is being cleared. Chunk buffers are only reallocated while pages are loaded or the
+    // chunk index is built, hence growing a chunk here never moves its content.
+
+    // chunks must be resized first, since the size of a chunk limits the blocks that can be written.
+    for (auto* block: modifiedBlocks) {
+        auto& chunk = table.chunks[block->chunkIndex];
+        if (!block->isModified() || !chunk.isSizeBlock(block)) continue;
+        std::unique_lock<std::mutex> lock(chunk.ptr->getContentMutex(), std::defer_lock);
+        if (speculative) lock.lock();
+        chunk.ptr->setSize(block->read<uint32>(0));
+    }
+    for (auto* block: modifiedBlocks) {
+        auto& chunk = table.chunks[block->chunkIndex];
+        if (!block->isModified() || chunk.isSizeBlock(block) || !chunk.ptr->isWritable()) continue;
+        auto chunkSize = chunk.sizeBlock().read<uint32>(0);
+        auto offset = table.offsets[block - table.blocks];
+        // We should make sure that we never write outside the chunk.
+        if (offset < chunkSize) {
+            std::unique_lock<std::mutex> lock(chunk.ptr->getContentMutex(), std::defer_lock);
+            if (speculative) lock.lock();
+            block->wrToHeap(chunk.ptr, chunkSize - offset, speculative);
+            chunk.ptr->markModified(offset, offset + std::min(block->getSize(), chunkSize - offset));
         }
     }
 }
 
 void RestrictedModifier::updateChunkSize(uint32 newSize) {
-    auto oldSize = currentChunk->sizeBlock().read<uint32>(currentVersion, 0);
+    auto oldSize = currentChunk->sizeBlock().read<uint32>(0);
     if (newSize == oldSize) return;
 
     if (currentChunk->resizing == ChunkInfo::ResizingType::expandable) {
@@ -103,78 +156,241 @@ void RestrictedModifier::updateChunkSize(uint32 newSize) {
     } else {
         throw std::out_of_range("chunk is not resizable");
     }
-    currentChunk->sizeBlock().write(currentVersion, 0, newSize);
+    currentChunk->sizeBlock().write(undoLog, 0, newSize);
 }
 
 uint32 RestrictedModifier::getChunkSize() {
     if (currentChunk->resizing == ChunkInfo::ResizingType::non_accessible) {
         throw std::out_of_range("chunkSize is not accessible");
     }
-    return currentChunk->sizeBlock().read<uint32>(currentVersion, 0);
+    return currentChunk->sizeBlock().read<uint32>(0);
 }
 
-void RestrictedModifier::AccessBlock::syncTo(int16_t version) {
-    while (!versionList.empty() && versionList.back().number > version) {
-        versionList.pop_back();
+void RestrictedModifier::UndoLog::undo(std::size_t version) {
+    assert(version < marks.size());
+    auto first = marks[version];
+    for (auto i = records.size(); i > first; --i) {
+        auto& record = records[i - 1];
+        if (record.created) {
+            record.block->modified = false;
+        } else {
+            memcpy(record.block->shadow + record.offset, data.data() + record.dataOffset, record.length);
+        }
     }
+    if (first < records.size()) data.resize(records[first].dataOffset);
+    records.resize(first);
+    marks.resize(version);
 }
 
-bool RestrictedModifier::AccessBlock::ensureExists(int16_t version) {
-    assert(version >= 1);
-    // checks are ordered for having the best performance on average
-    if (!versionList.empty()) {
-        auto latestVersion = versionList.back().number;
-        assert(latestVersion <= version);
-        if (latestVersion == version) return false;
+void RestrictedModifier::UndoLog::recordCreation(AccessBlock& block) {
+    if (!block.listed) {
+        block.listed = true;
+        modifiedBlocks.push_back(&block);
     }
+    // when no version is saved, modifications can not be undone and there is no need for recording them.
+    if (marks.empty()) return;
+    block.lastRecord = records.size();
+    records.push_back({&block, 0, 0, data.size(), true});
+}
 
-    versionList.emplace_back(version, size);
-    return true;
+void RestrictedModifier::UndoLog::recordOverwrite(AccessBlock& block, uint32 offset, uint32 length) {
+    if (marks.empty()) return;
+    // If the block has a record after the last mark which covers this range, the content that must be restored is
+    // already saved.
+    if (block.lastRecord < records.size() && block.lastRecord >= marks.back()) {
+        auto& last = records[block.lastRecord];
+        if (last.block == &block &&
+            (last.created || (last.offset <= offset && offset + length <= last.offset + last.length))) {
+            return;
+        }
+    }
+    block.lastRecord = records.size();
+    records.push_back({&block, offset, length, data.size(), false});
+    data.insert(data.end(), block.shadow + offset, block.shadow + offset + length);
+}
+
+void RestrictedModifier::UndoLog::clear() {
+    records.clear();
+    modifiedBlocks.clear();
+    data.clear();
+    marks.clear();
+    arena.release();
 }
 
-byte* RestrictedModifier::AccessBlock::prepareToRead(int16_t version, uint32 offset, uint32 readSize) {
+byte* RestrictedModifier::AccessBlock::prepareToRead(uint32 offset, uint32 readSize) {
     if (int64(offset) + int64(readSize) > int64(size)) throw std::out_of_range("out of block read");
     if (accessType.denies(Access::Operation::read)) {
         throw std::out_of_range("access block is not readable");
     }
-    syncTo(version);
-    return versionList.empty() ? heapLocation.get() + offset : versionList.back().getContent() + offset;
+    if (modified || snapshotTaken) return shadow + offset;
+    heapRead = true;
+    return heapLocation.get() + offset;
 }
 
-byte* RestrictedModifier::AccessBlock::prepareToWrite(int16_t version, uint32 offset, uint32 writeSize) {
+byte* RestrictedModifier::AccessBlock::prepareToWrite(UndoLog& log, uint32 offset, uint32 writeSize) {
     if (int64(offset) + int64(writeSize) > int64(size)) throw std::out_of_range("out of block write");
     if (accessType.denies(Access::Operation::write)) {
         throw std::out_of_range("block is not writable");
     }
-    syncTo(version);
-    auto oldContent = versionList.empty() ? heapLocation.get() : versionList.back().getContent();
-    bool added = ensureExists(version);
-    if (added && size != writeSize) {
-        memcpy(versionList.back().getContent(), oldContent, offset);
-        memcpy(versionList.back().getContent() + offset + writeSize, oldContent + offset + writeSize,
-               size - writeSize - offset);
+    if (modified) {
+        log.recordOverwrite(*this, offset, writeSize);
+        return shadow + offset;
     }
+    // the working copy is kept when a modification is undone, so it can be reused here.
+    if (shadow == nullptr) shadow = log.allocate(size);
+    if (snapshotTaken) {
+        snapshotTaken = false;
+    } else if (size != writeSize) {
+        heapRead = true;
+        memcpy(shadow, heapLocation.get(), offset);
+        memcpy(shadow + offset + writeSize, heapLocation.get() + offset + writeSize, size - writeSize - offset);
+    }
+    log.recordCreation(*this);
+    modified = true;
+    return shadow + offset;
+}
 
-    return versionList.back().getContent() + offset;
+byte* RestrictedModifier::AccessBlock::prepareToAdd(UndoLog& log) {
+    if (modified) {
+        log.recordOverwrite(*this, 0, size);
+        return shadow;
+    }
+    // The working copy of an additive block holds the sum of the added values, which will be added to the heap by
+    // wrToHeap().
+    if (shadow == nullptr) shadow = log.allocate(size);
+    memset(shadow, 0, size);
+    snapshotTaken = false;
+    log.recordCreation(*this);
+    modified = true;
+    return shadow;
 }
 
-void RestrictedModifier::AccessBlock::wrToHeap(Chunk* chunk, int16_t version, uint32 maxWriteSize) {
-    syncTo(version);
-    if (versionList.empty()) return;
+void RestrictedModifier::AccessBlock::takeSnapshot(UndoLog& log, Chunk* chunk) {
+    if (modified || snapshotTaken) return;
+    if (shadow == nullptr) shadow = log.allocate(size);
+    std::lock_guard<std::mutex> lock(chunk->getContentMutex());
+    memcpy(shadow, heapLocation.get(), size);
+    snapshotTaken = heapRead = true;
+}
 
-    auto writeSize = std::min(size, maxWriteSize);
+template<typename T>
+static inline
+void fetchAdd(byte* location, const byte* value) {
+    T a;
+    memcpy(&a, value, sizeof(T));
+    std::atomic_ref<T>(*reinterpret_cast<T*>(location)).fetch_add(a, std::memory_order_relaxed);
+}
+
+/// adds the integer stored in @p value to the integer stored in @p location, using an atomic fetch_add. When
+/// @p location is not naturally aligned this function does nothing and returns false.
+static inline
+bool addAtomically(byte* location, const byte* value, uint32 size) {
+    if (reinterpret_cast<std::uintptr_t>(location) % size != 0) return false;
+    switch (size) {
+        case 1:
+            fetchAdd<uint8_t>(location, value);
+            return true;
+        case 2:
+            fetchAdd<uint16_t>(location, value);
+            return true;
+        case 4:
+            fetchAdd<uint32_t>(location, value);
+            return true;
+        case 8:
+            fetchAdd<uint64_t>(location, value);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// throws an out_of_range error if @p value can not be added to a float additive block. Accepted values are on a grid
+/// of 2^-16 and smaller than 2^37.
+static inline
+void checkAdditiveFloat(float64 value) {
+    // the negated condition also rejects NaN values.
+    if (!(std::abs(value) < 0x1p37)) throw std::out_of_range("float additive value is out of range");
+    if (std::trunc(value * 0x1p16) != value * 0x1p16) {
+        throw std::out_of_range("float additive value is not on the grid");
+    }
+}
+
+/// converts @p value to a number of 2^-16 steps modulo 2^54. This function accepts any value that may be stored in the
+/// heap: values off the grid are truncated and non-finite values are treated as zero.
+static inline
+uint64_t toGridSteps(float64 value) {
+    if (!std::isfinite(value)) return 0;
+    // fmod is exact and 2^38 is 2^54 steps, so wrapping the value before scaling does not change the result.
+    return uint64_t(int64(std::trunc(std::fmod(value, 0x1p38) * 0x1p16)));
+}
+
+/// Float additive values are fixed point numbers which wrap around in [-2^37, 2^37), like a signed integer. Hence,
+/// the sum is associative and never fails, and the result of commits does not depend on their order.
+static inline
+float64 addOnGrid(float64 a, float64 b) {
+    constexpr uint64_t half = uint64_t(1) << 53, mask = (uint64_t(1) << 54) - 1;
+    // every value of [-2^53, 2^53) is exactly representable by a float64.
+    auto steps = int64((toGridSteps(a) + toGridSteps(b) + half) & mask) - int64(half);
+    return float64(steps) / 0x1p16;
+}
+
+/// adds the float stored in @p value to the float stored in @p location, using a compare-exchange loop. When
+/// @p location is not naturally aligned this function does nothing and returns false.
+static inline
+bool addFloatAtomically(byte* location, const byte* value) {
+    if (reinterpret_cast<std::uintptr_t>(location) % alignof(float64) != 0) return false;
+    float64 a;
+    memcpy(&a, value, sizeof(float64));
+    std::atomic_ref<float64> target(*reinterpret_cast<float64*>(location));
+    auto current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, addOnGrid(current, a), std::memory_order_relaxed));
+    return true;
+}
 
-    if (accessType.isAdditive()) {
+void RestrictedModifier::AccessBlock::addFloat(UndoLog& log, float64 value) {
+    if (sizeof(float64) != size) throw std::out_of_range("addFloat size");
+    if (accessType.denies(AccessBlockInfo::Access::Operation::float_add)) {
+        throw std::out_of_range("block is not float additive");
+    }
+    checkAdditiveFloat(value);
+    auto content = prepareToAdd(log);
+    float64 current;
+    memcpy((byte*) &current, content, sizeof(float64));
+    current = addOnGrid(current, value);
+    memcpy(content, (byte*) &current, sizeof(float64));
+}
+
+void RestrictedModifier::AccessBlock::wrToHeap(Chunk* chunk, uint32 maxWriteSize, bool locked) {
+    if (!modified) return;
+
+    auto writeSize = std::min(size, maxWriteSize);
+    // When the caller holds the mutex, the atomic paths are not needed and the mutex must not be locked again.
+    std::unique_lock<std::mutex> lock(chunk->getContentMutex(), std::defer_lock);
+
+    if (accessType == Access::Type::float_additive) {
+        // a truncated float is meaningless, so a block that does not fit in the chunk is not written.
+        if (writeSize < size) return;
+        if (!locked && addFloatAtomically(heapLocation.get(), shadow)) return;
+        float64 s, a;
+        if (!locked) lock.lock();
+        memcpy(&s, heapLocation.get(), sizeof(float64));
+        memcpy(&a, shadow, sizeof(float64));
+        s = addOnGrid(s, a);
+        memcpy(heapLocation.get(), &s, sizeof(float64));
+    } else if (accessType.isAdditive()) {
+        // The scheduler never runs requests with overlapping additive blocks of different sizes in parallel, so all
+        // concurrent commits of a location use the same path: either they are all atomic or all use the mutex.
+        if (!locked && writeSize == size && addAtomically(heapLocation.get(), shadow, size)) return;
         int64_fast s = 0, a = 0;
         assert(size <= sizeof(int64_t));
-        std::lock_guard<std::mutex> lock(chunk->getContentMutex());
+        if (!locked) lock.lock();
         memcpy(&s, heapLocation.get(), size);
-        memcpy(&a, versionList.back().getContent(), size);
+        memcpy(&a, shadow, size);
         s += a;
-        // mem copy should be inside this if block to make sure that lock_guard is protecting it.
+        // mem copy should be inside this if block to make sure that the lock is protecting it.
         memcpy(heapLocation.get(), &s, writeSize);
     } else {
-        memcpy(heapLocation.get(), versionList.back().getContent(), writeSize);
+        memcpy(heapLocation.get(), shadow, writeSize);
     }
 }
 
@@ -193,14 +409,7 @@ RestrictedModifier::ChunkInfo::ChunkInfo(Chunk* chunk, ResizingType resizingType
         accessTable(toAccessBlocks(chunk, sortedAccessedOffsets, accessInfoList)),
         ptr(chunk),
         resizing(resizingType),
-        sizeBound(sizeBound),
-        size(
-                Chunk::Pointer((byte*) (&initialSize), sizeof(initialSize)),
-                sizeof(initialSize),
-                AccessBlockInfo::Access(
-                        resizingType == ResizingType::expandable || resizingType == ResizingType::shrinkable ?
-                        Access::Type::writable : Access::Type::read_only)
-        ) {
+        sizeBound(sizeBound) {
     assert(sizeBound <= max_chunk_size);
 }
 
@@ -215,10 +424,7 @@ RestrictedModifier::AccessTableMap RestrictedModifier::ChunkInfo::toAccessBlocks
     resultOffsets.reserve(offsets.size());
 
     for (long i = 0; i < offsets.size(); ++i) {
-        if (accessInfoList[i].accessType.mayWrite() && !chunk->isWritable()) {
-            throw BlockError("trying to modify a readonly chunk");
-        }
-
+        checkAccess(chunk, accessInfoList[i]);
         if (offsets[i] >= 0) {
             resultOffsets.emplace_back(offsets[i]);
             blocks.emplace_back(
@@ -230,3 +436,119 @@ RestrictedModifier::AccessTableMap RestrictedModifier::ChunkInfo::toAccessBlocks
     }
     return {std::move(resultOffsets), std::move(blocks)};
 }
+
+RestrictedModifier::AccessBlock& RestrictedModifier::findAccessBlock(uint32 offset) {
+    auto begin = table.offsets + currentChunk->firstBlock;
+    auto end = table.offsets + currentChunk->endBlock;
+    auto found = std::lower_bound(begin, end, offset);
+    if (found == end || *found != offset) throw AccessError(offset);
+    currentChunk->lastHit = found - table.offsets;
+    return table.blocks[currentChunk->lastHit];
+}
+
+RestrictedModifier::AccessTable RestrictedModifier::toAccessTable(const vector<long_id>& apps,
+                                                                  vector<ChunkMap64> chunkMaps) {
+    if (apps.size() != chunkMaps.size()) throw std::invalid_argument("size mismatch in apps and chunk maps");
+    std::size_t chunkCount = 0, blockCount = 0;
+    for (const auto& chunkMap: chunkMaps) {
+        chunkCount += chunkMap.size();
+        for (const auto& chunk: chunkMap.getValues()) blockCount += chunk.accessTable.size();
+    }
+
+    AccessTable result(apps.size(), chunkCount, blockCount);
+    for (std::size_t i = 0; i < apps.size(); ++i) {
+        result.addApp(apps[i]);
+        for (long j = 0; j < chunkMaps[i].size(); ++j) {
+            auto& chunk = chunkMaps[i].getValues()[j];
+            result.addChunk(chunkMaps[i].getKeys()[j], chunk.ptr, chunk.resizing, chunk.sizeBound);
+            for (long k = 0; k < chunk.accessTable.size(); ++k) {
+                result.addBlock(chunk.accessTable.getKeys()[k], std::move(chunk.accessTable.getValues()[k]));
+            }
+        }
+    }
+    return result;
+}
+
+RestrictedModifier::ChunkEntry::ChunkEntry(uint32 index, long_long_id id, Chunk* chunk,
+                                           ChunkInfo::ResizingType resizingType, uint32 sizeBound, uint32 firstBlock) :
+        id(id),
+        ptr(chunk),
+        resizing(resizingType),
+        sizeBound(sizeBound),
+        firstBlock(firstBlock),
+        endBlock(firstBlock),
+        lastHit(firstBlock),
+        size(
+                Chunk::Pointer((byte*) (&initialSize), sizeof(initialSize)),
+                sizeof(initialSize),
+                AccessBlockInfo::Access(
+                        resizingType == ChunkInfo::ResizingType::expandable ||
+                        resizingType == ChunkInfo::ResizingType::shrinkable ?
+                        Access::Type::writable : Access::Type::read_only)
+        ) {
+    assert(sizeBound <= max_chunk_size);
+    size.chunkIndex = index;
+}
+
+RestrictedModifier::AccessTable::AccessTable(std::size_t appCapacity, std::size_t chunkCapacity,
+                                             std::size_t blockCapacity) :
+        appCapacity(appCapacity), chunkCapacity(chunkCapacity), blockCapacity(blockCapacity) {
+    // Entries are placed in the table by placement new and are never destructed.
+    static_assert(std::is_trivially_destructible_v<AccessBlock> && std::is_trivially_destructible_v<ChunkEntry>);
+    auto appsSize = alignedSize(appCapacity * sizeof(AppEntry));
+    auto chunksSize = alignedSize(chunkCapacity * sizeof(ChunkEntry));
+    auto blocksSize = alignedSize(blockCapacity * sizeof(AccessBlock));
+    auto offsetsSize = alignedSize(blockCapacity * sizeof(uint32));
+    auto totalSize = appsSize + chunksSize + blocksSize + offsetsSize;
+
+    storage.reset(new std::max_align_t[(totalSize + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)]);
+    auto base = reinterpret_cast<byte*>(storage.get());
+    apps = reinterpret_cast<AppEntry*>(base);
+    chunks = reinterpret_cast<ChunkEntry*>(base + appsSize);
+    blocks = reinterpret_cast<AccessBlock*>(base + appsSize + chunksSize);
+    offsets = reinterpret_cast<uint32*>(base + appsSize + chunksSize + blocksSize);
+}
+
+RestrictedModifier::AccessTable::AccessTable(AccessTable&& other) noexcept:
+        storage(std::move(other.storage)),
+        apps(std::exchange(other.apps, nullptr)),
+        chunks(std::exchange(other.chunks, nullptr)),
+        blocks(std::exchange(other.blocks, nullptr)),
+        offsets(std::exchange(other.offsets, nullptr)),
+        appCount(std::exchange(other.appCount, 0)),
+        chunkCount(std::exchange(other.chunkCount, 0)),
+        blockCount(std::exchange(other.blockCount, 0)),
+        appCapacity(std::exchange(other.appCapacity, 0)),
+        chunkCapacity(std::exchange(other.chunkCapacity, 0)),
+        blockCapacity(std::exchange(other.blockCapacity, 0)) {}
+
+void RestrictedModifier::AccessTable::addApp(long_id appID) {
+    if (appCount == appCapacity) throw std::length_error("access table: too many apps");
+    new(apps + appCount++) AppEntry{appID, chunkCount, chunkCount};
+}
+
+void RestrictedModifier::AccessTable::addChunk(long_long_id chunkID, Chunk* chunk,
+                                               ChunkInfo::ResizingType resizingType, uint32 sizeBound) {
+    if (chunkCount == chunkCapacity) throw std::length_error("access table: too many chunks");
+    assert(appCount > 0);
+    new(chunks + chunkCount) ChunkEntry(chunkCount, chunkID, chunk, resizingType, sizeBound, blockCount);
+    ++chunkCount;
+    apps[appCount - 1].endChunk = chunkCount;
+}
+
+void RestrictedModifier::AccessTable::addBlock(int32 offset, const AccessBlockInfo& info) {
+    assert(chunkCount > 0);
+    auto* chunk = chunks[chunkCount - 1].ptr;
+    checkAccess(chunk, info);
+    if (offset < 0) return;
+    addBlock(offset, AccessBlock(chunk->getContentPointer(offset, info.size), info.size, info.accessType));
+}
+
+void RestrictedModifier::AccessTable::addBlock(uint32 offset, AccessBlock&& block) {
+    if (blockCount == blockCapacity) throw std::length_error("access table: too many access blocks");
+    assert(chunkCount > 0);
+    offsets[blockCount] = offset;
+    new(blocks + blockCount) AccessBlock(std::move(block));
+    blocks[blockCount++].chunkIndex = chunkCount - 1;
+    chunks[chunkCount - 1].endBlock = blockCount;
+}
@@ -19,7 +19,11 @@
 #define ARGENNON_HEAP_MODIFIER_H
 
 #include <exception>
+#include <cmath>
 #include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <vector>
 #include "Chunk.h"
 #include "util/PrefixTrie.hpp"
@@ -31,34 +35,40 @@ class RestrictedModifier {
 public:
     template<typename T>
     inline
-    T load(uint32 offset, uint32 index = 0) { return getAccessBlock(offset).read<T>(currentVersion, index); }
+    T load(uint32 offset, uint32 index = 0) { return getReadBlock(offset).read<T>(index); }
 
     template<typename T, int h>
     inline
     T loadVarUInt(const util::PrefixTrie<T, h>& trie, uint32 offset, uint32 index = 0, int32* n = nullptr) {
-        return getAccessBlock(offset).readVarUInt(trie, currentVersion, index, n);
+        return getReadBlock(offset).readVarUInt(trie, index, n);
     }
 
     template<typename T, int h>
     inline
     T loadIdentifier(const util::PrefixTrie<T, h>& trie, uint32 offset, uint32 index = 0, int32* n = nullptr) {
-        return getAccessBlock(offset).readIdentifier(trie, currentVersion, index, n);
+        return getReadBlock(offset).readIdentifier(trie, index, n);
     }
 
     template<typename T>
     inline
     void store(uint32 offset, const T& value, uint32 index = 0) {
-        getAccessBlock(offset).write<T>(currentVersion, index, value);
+        auto& block = getAccessBlock(offset);
+        // a partial write copies the rest of the block from the heap.
+        if (speculative && sizeof(T) != block.getSize()) block.takeSnapshot(undoLog, currentChunk->ptr);
+        block.template write<T>(undoLog, index, value);
     }
 
     template<typename T>
     inline
-    void addInt(uint32 offset, T value) { getAccessBlock(offset).addInt<T>(currentVersion, value); }
+    void addInt(uint32 offset, T value) { getAccessBlock(offset).addInt<T>(undoLog, value); }
+
+    inline
+    void addFloat(uint32 offset, float64 value) { getAccessBlock(offset).addFloat(undoLog, value); }
 
     template<typename T, int h>
     inline
     int storeVarUInt(const util::PrefixTrie<T, h>& trie, uint32 offset, T value) {
-        return getAccessBlock(offset).writeVarUInt(trie, currentVersion, value);
+        return getReadBlock(offset).writeVarUInt(trie, undoLog, 0, value);
     }
 
     void loadChunk(long_id localID);
@@ -71,8 +81,17 @@ public:
 
     int16_t saveVersion();
 
+    /// writes all modifications to the heap. In speculative mode the content mutex of every modified chunk is held
+    /// while its blocks are written, so snapshots taken by other requests are never torn.
     void writeToHeap();
 
+    /**
+     * In speculative mode other requests may commit to the heap while this request is being executed. Then, the
+     * content of an access block is copied from the heap under the content mutex of its chunk when the block is
+     * read for the first time, and later reads only use that copy.
+     */
+    void setSpeculative(bool value) { speculative = value; }
+
     bool isValid(uint32 offset, uint32 size) {
         // we need to make sure that the access block is defined. Otherwise, scheduler can not guarantee that
         // isValid is properly parallelized with chunk resizing requests. Also, we need to make sure that an access
@@ -82,14 +101,108 @@ public:
             throw std::out_of_range("isValid: access block not defined");
         }
         // we can't use getChunkSize() here
-        return int64(offset) + int64(size) <= (int64) currentChunk->sizeBlock().read<uint32>(currentVersion, 0);
+        return int64(offset) + int64(size) <= (int64) currentChunk->sizeBlock().read<uint32>(0);
     }
 
     uint32 getChunkSize();
 
     void updateChunkSize(uint32 newSize);
 
+    /// in the ranges reported by forEachHeapRead() and forEachHeapWrite() the size of a chunk is represented by
+    /// [chunk_size_offset, chunk_size_offset + 1)
+    static constexpr uint32 chunk_size_offset = Chunk::maxAllowedCapacity;
+
+    /**
+     * Calls @p visitor(Chunk* chunk, uint32 begin, uint32 end) for every range of the heap that was read directly
+     * from the heap, since the last call to reset().
+     */
+    template<class Visitor>
+    void forEachHeapRead(Visitor&& visitor) {
+        for (auto& chunk: table.getChunks()) {
+            if (chunk.isSizeObserved()) visitor(chunk.ptr, chunk_size_offset, chunk_size_offset + 1);
+            for (auto i = chunk.firstBlock; i < chunk.endBlock; ++i) {
+                auto& block = table.blocks[i];
+                if (block.isHeapRead()) visitor(chunk.ptr, table.offsets[i], table.offsets[i] + block.getSize());
+            }
+        }
+    }
+
+    /**
+     * Calls @p visitor(Chunk* chunk, uint32 begin, uint32 end) for every range of the heap that will be modified
+     * by writeToHeap(). When a chunk is resized, the whole chunk including its size is reported.
+     */
+    template<class Visitor>
+    void forEachHeapWrite(Visitor&& visitor) {
+        for (auto* block: undoLog.getModifiedBlocks()) {
+            if (!block->isModified()) continue;
+            auto& chunk = table.chunks[block->chunkIndex];
+            if (chunk.isSizeBlock(block)) {
+                visitor(chunk.ptr, 0, chunk_size_offset + 1);
+            } else if (!chunk.sizeBlock().isModified()) {
+                auto offset = table.offsets[block - table.blocks];
+                visitor(chunk.ptr, offset, offset + block->getSize());
+            }
+        }
+    }
+
+    /// Discards all modifications and brings the modifier back to its initial state, so it can be used for executing
+    /// the request again.
+    void reset();
+
 private:
+    class AccessBlock;
+
+    /**
+     * A session-wide log of the overwritten content of access blocks. A saved version is just a mark in the log, and a
+     * version is restored by replaying the log backwards until the mark is reached. Only the overwritten bytes are
+     * recorded, so the memory used by a request depends on the number of written bytes, not on the size of blocks.
+     *
+     * The log also keeps the list of blocks that were modified since the last call to clear(), so committing a
+     * request does not need to visit unmodified blocks.
+     */
+    class UndoLog {
+    public:
+        void mark() { marks.push_back(records.size()); }
+
+        [[nodiscard]]
+        std::size_t getMarkCount() const { return marks.size(); }
+
+        /// undoes all modifications recorded after the mark with index @p version, and removes that mark and all marks
+        /// after it.
+        void undo(std::size_t version);
+
+        /// records that @p block was modified for the first time.
+        void recordCreation(AccessBlock& block);
+
+        /// returns the blocks which were modified since the last call to clear(). A block may be in this list even
+        /// if its modifications were undone later.
+        [[nodiscard]]
+        const std::vector<AccessBlock*>& getModifiedBlocks() const { return modifiedBlocks; }
+
+        /// records the content of the range [offset, offset + length) of @p block before overwriting it.
+        void recordOverwrite(AccessBlock& block, uint32 offset, uint32 length);
+
+        /// allocates a working copy for a block. The memory is released by clear().
+        byte* allocate(uint32 size) { return static_cast<byte*>(arena.allocate(size, alignof(int64))); }
+
+        void clear();
+
+    private:
+        struct Record {
+            AccessBlock* block;
+            uint32 offset;
+            uint32 length;
+            std::size_t dataOffset;
+            bool created;
+        };
+
+        std::vector<Record> records;
+        std::vector<AccessBlock*> modifiedBlocks;
+        std::vector<byte> data;
+        std::vector<std::size_t> marks;
+        std::pmr::monotonic_buffer_resource arena;
+    };
+
     class AccessBlock {
     public:
         AccessBlock() = default;
@@ -108,22 +221,37 @@ private:
         [[nodiscard]] inline
         uint32 getSize() const { return size; }
 
+        [[nodiscard]] inline
+        bool isHeapRead() const { return heapRead; }
+
+        [[nodiscard]] inline
+        bool isModified() const { return modified; }
+
+        void reset() {
+            shadow = nullptr;
+            modified = false;
+            snapshotTaken = false;
+            heapRead = false;
+            listed = false;
+            lastRecord = no_record;
+        }
+
         template<typename T, int h>
         inline
-        T readIdentifier(const util::PrefixTrie<T, h>& trie, int16_t version, uint32 index, int32* n = nullptr) {
-            return trie.readPrefixCode(prepareToRead(version, index, size), n, size);
+        T readIdentifier(const util::PrefixTrie<T, h>& trie, uint32 index, int32* n = nullptr) {
+            return trie.readPrefixCode(prepareToRead(index, size), n, size);
         }
 
         template<typename T, int h>
         inline
-        T readVarUInt(const util::PrefixTrie<T, h>& trie, int16_t version, uint32 index, int32* n = nullptr) {
-            return trie.decodeVarUInt(prepareToRead(version, index, size), n, size);
+        T readVarUInt(const util::PrefixTrie<T, h>& trie, uint32 index, int32* n = nullptr) {
+            return trie.decodeVarUInt(prepareToRead(index, size), n, size);
         }
 
         template<typename T>
         inline
-        T read(int16_t version, uint32 index) {
-            auto content = prepareToRead(version, index, sizeof(T));
+        T read(uint32 index) {
+            auto content = prepareToRead(index, sizeof(T));
 
             T ret{};
             memcpy((byte*) &ret, content, sizeof(T));
@@ -134,65 +262,84 @@ private:
 
         template<typename T, int h>
         inline
-        int writeVarUInt(const util::PrefixTrie<T, h>& trie, int16_t version, uint32 index, T value) {
+        int writeVarUInt(const util::PrefixTrie<T, h>& trie, UndoLog& log, uint32 index, T value) {
             int len;
             auto code = trie.encodeVarUInt(value, &len);
-            trie.writeBigEndian(prepareToWrite(version, index, len), code, len);
+            trie.writeBigEndian(prepareToWrite(log, index, len), code, len);
             return len;
         }
 
 
         template<typename T>
         inline
-        void write(int16_t version, uint32 index, const T& value) {
-            memcpy(prepareToWrite(version, index, sizeof(value)), (byte*) &value, sizeof(value));
+        void write(UndoLog& log, uint32 index, const T& value) {
+            memcpy(prepareToWrite(log, index, sizeof(value)), (byte*) &value, sizeof(value));
         }
 
         template<typename T>
         inline
-        void addInt(int16_t version, T value) {
+        void addInt(UndoLog& log, T value) {
             static_assert(std::is_integral<T>::value);
             if (sizeof(T) != size) throw std::out_of_range("addInt size");
             if (accessType.denies(AccessBlockInfo::Access::Operation::int_add)) {
                 throw std::out_of_range("block is not additive");
             }
-            syncTo(version);
+            auto content = prepareToAdd(log);
             T current;
-            if (versionList.empty()) current = 0;
-            else memcpy((byte*) &current, versionList.back().getContent(), sizeof(T));
+            memcpy((byte*) &current, content, sizeof(T));
             current += value;
-            ensureExists(version);
-            memcpy(versionList.back().getContent(), (byte*) &current, sizeof(T));
+            memcpy(content, (byte*) &current, sizeof(T));
         }
 
-        void wrToHeap(Chunk* chunk, int16_t version, uint32 maxWriteSize);
+        /**
+         * Float additions can be committed in any order, so they must be exact to give a deterministic result.
+         * Added values must be on a grid of 2^-16 and smaller than 2^37. Sums are calculated on the same grid and
+         * wrap around in [-2^37, 2^37), so they are exact and committing them never fails.
+         */
+        void addFloat(UndoLog& log, float64 value);
 
-    private:
-        struct Version {
-            const int16_t number;
-            std::unique_ptr<byte[]> content;
+        /// copies the content of the block from the heap into its working copy, if the block is not modified and a
+        /// snapshot is not taken yet. The content mutex of @p chunk is held while copying.
+        void takeSnapshot(UndoLog& log, Chunk* chunk);
 
-            inline byte* getContent() { return content.get(); } // NOLINT(readability-make-member-function-const)
+        /// adds the modifications of the block to the heap. When @p locked is true the caller holds the content
+        /// mutex of @p chunk.
+        void wrToHeap(Chunk* chunk, uint32 maxWriteSize, bool locked = false);
 
-            Version(int16_t version, uint32 size) : number(version), content(std::make_unique<byte[]>(size)) {}
-        };
+        /// the index of the chunk of this block in the access table of the modifier.
+        uint32 chunkIndex = 0;
+
+    private:
+        friend class UndoLog;
+
+        static constexpr std::size_t no_record = SIZE_MAX;
 
         Chunk::Pointer heapLocation;
         uint32 size = 0;
         AccessBlockInfo::Access accessType{AccessBlockInfo::Access::Type::read_only};;
-        std::vector<Version> versionList;
-
-        void syncTo(int16_t version);
-
-        bool ensureExists(int16_t version);
-
-        byte* prepareToRead(int16_t version, uint32 offset, uint32 readSize);
-
-        byte* prepareToWrite(int16_t version, uint32 offset, uint32 writeSize);
+        /// the working copy of the block. It is allocated on the first write or snapshot, and is valid when the block is
+        /// modified or a snapshot is taken.
+        byte* shadow = nullptr;
+        bool modified = false;
+        bool heapRead = false;
+        /// indicates that the working copy holds a snapshot of the heap. The snapshot is consumed when the block is
+        /// modified, because undoing the modification does not restore it.
+        bool snapshotTaken = false;
+        /// indicates that the block is in the list of modified blocks of the undo log.
+        bool listed = false;
+        /// the index of the last record of this block in the undo log, which is used for avoiding redundant records.
+        std::size_t lastRecord = no_record;
+
+        byte* prepareToRead(uint32 offset, uint32 readSize);
+
+        byte* prepareToWrite(UndoLog& log, uint32 offset, uint32 writeSize);
+
+        byte* prepareToAdd(UndoLog& log);
     };
 
     typedef util::OrderedStaticMap<uint32, AccessBlock> AccessTableMap;
 public:
+    /// Describes a chunk and the access blocks defined on it, for building the access table of a modifier.
     class ChunkInfo {
     public:
         enum class ResizingType {
@@ -221,12 +368,6 @@ public:
 
         ChunkInfo(const ChunkInfo&) = delete;
 
-        AccessBlock& sizeBlock() {
-            // first we need to initialize initialSize
-            if (initialSize == UINT32_MAX) initialSize = ptr->getsize();
-            return size;
-        }
-
         static RestrictedModifier::AccessTableMap toAccessBlocks(
                 Chunk* chunk,
                 const std::vector<int32>& offsets,
@@ -237,15 +378,103 @@ public:
         Chunk* ptr{};
         const ResizingType resizing;
         const uint32 sizeBound = 0;
+    };
+
+    typedef util::OrderedStaticMap<long_long_id, ChunkInfo> ChunkMap64;
+
+private:
+    /// The state of a chunk in an access table. The access blocks of the chunk are stored in the range
+    /// [firstBlock, endBlock) of the table, sorted by their offsets.
+    class ChunkEntry {
+    public:
+        ChunkEntry(uint32 index, long_long_id id, Chunk* chunk, ChunkInfo::ResizingType resizingType,
+                   uint32 sizeBound, uint32 firstBlock);
+
+        AccessBlock& sizeBlock() {
+            // first we need to initialize initialSize
+            if (initialSize == UINT32_MAX) initialSize = ptr->getsize();
+            return size;
+        }
+
+        /// indicates that the size of the chunk was read from the heap.
+        [[nodiscard]]
+        bool isSizeObserved() const { return initialSize != UINT32_MAX; }
+
+        [[nodiscard]]
+        bool isSizeBlock(const AccessBlock* block) const { return block == &size; }
+
+        void reset() {
+            size.reset();
+            initialSize = UINT32_MAX;
+            lastHit = firstBlock;
+        }
+
+        const long_long_id id;
+        Chunk* const ptr;
+        const ChunkInfo::ResizingType resizing;
+        const uint32 sizeBound;
+        const uint32 firstBlock;
+        uint32 endBlock;
+        /// the index of the last accessed block of this chunk.
+        uint32 lastHit;
     private:
         AccessBlock size;
         uint32 initialSize = UINT32_MAX;
     };
 
-    typedef util::OrderedStaticMap<long_long_id, ChunkInfo> ChunkMap64;
+    struct AppEntry {
+        long_id id;
+        uint32 firstChunk;
+        uint32 endChunk;
+    };
+
+public:
+    /**
+     * A flat table containing all apps, chunks and access blocks that a request can access. All descriptors and
+     * access blocks of the table are stored in a single allocation. Apps, the chunks of an app, and the access blocks
+     * of a chunk must be added in sorted order.
+     */
+    class AccessTable {
+    public:
+        AccessTable() = default;
 
-    RestrictedModifier(std::vector<long_id> apps, std::vector<ChunkMap64> chunkMaps) :
-            appsAccessMaps(std::move(apps), std::move(chunkMaps)) {}
+        /// reserves the memory of the table. The capacities are upper bounds and the table may use less space.
+        AccessTable(std::size_t appCapacity, std::size_t chunkCapacity, std::size_t blockCapacity);
+
+        AccessTable(AccessTable&& other) noexcept;
+
+        AccessTable(const AccessTable&) = delete;
+
+        void addApp(long_id appID);
+
+        /// adds a chunk to the last added app.
+        void addChunk(long_long_id chunkID, Chunk* chunk, ChunkInfo::ResizingType resizingType, uint32 sizeBound);
+
+        /// adds an access block to the last added chunk. Negative offsets are ignored.
+        void addBlock(int32 offset, const AccessBlockInfo& info);
+
+    private:
+        friend class RestrictedModifier;
+
+        std::unique_ptr<std::max_align_t[]> storage;
+        AppEntry* apps = nullptr;
+        ChunkEntry* chunks = nullptr;
+        AccessBlock* blocks = nullptr;
+        uint32* offsets = nullptr;
+        uint32 appCount = 0, chunkCount = 0, blockCount = 0;
+        uint32 appCapacity = 0, chunkCapacity = 0, blockCapacity = 0;
+
+        void addBlock(uint32 offset, AccessBlock&& block);
+
+        std::span<AppEntry> getApps() { return {apps, appCount}; }
+
+        std::span<ChunkEntry> getChunks() { return {chunks, chunkCount}; }
+    };
+
+    explicit RestrictedModifier(AccessTable table) : table(std::move(table)) {}
+
+    RestrictedModifier(const std::vector<long_id>& apps, std::vector<ChunkMap64> chunkMaps) :
+            RestrictedModifier(toAccessTable(apps, std::move(chunkMaps))) {}
 
     RestrictedModifier() = default;
 
@@ -256,20 +485,46 @@ public:
     inline
     AccessBlock& getAccessBlock(uint32 offset) {
         if (currentChunk == nullptr) throw std::out_of_range("chunk is not loaded");
-        try {
-            return currentChunk->accessTable.at(offset);
-        } catch (const std::out_of_range&) {
-            throw std::out_of_range("no access block is defined at offset: " + std::to_string(offset));
+        // apps usually access the same block or the next one, so we check them before searching the chunk.
+        auto i = currentChunk->lastHit;
+        if (i < currentChunk->endBlock && table.offsets[i] == offset) return table.blocks[i];
+        if (++i < currentChunk->endBlock && table.offsets[i] == offset) {
+            currentChunk->lastHit = i;
+            return table.blocks[i];
         }
+        return findAccessBlock(offset);
     }
 
 private:
-    typedef util::OrderedStaticMap<long_id, ChunkMap64> AppMap;
+    /// An out_of_range error that keeps its message inline. Its std::out_of_range base is copied from a shared
+    /// instance, hence throwing an AccessError does not allocate a string.
+    class AccessError : public std::out_of_range {
+    public:
+        explicit AccessError(uint32 offset) noexcept;
+
+        [[nodiscard]] const char* what() const noexcept override { return message; }
+
+    private:
+        char message[64];
+    };
+
+    UndoLog undoLog;
+    AccessTable table;
+    AppEntry* currentApp = nullptr;
+    ChunkEntry* currentChunk = nullptr;
+    bool speculative = false;
+
+    AccessBlock& findAccessBlock(uint32 offset);
+
+    /// returns the access block at @p offset, and in speculative mode makes sure that its snapshot is taken.
+    inline
+    AccessBlock& getReadBlock(uint32 offset) {
+        auto& block = getAccessBlock(offset);
+        if (speculative) block.takeSnapshot(undoLog, currentChunk->ptr);
+        return block;
+    }
 
-    int16_t currentVersion = 0;
-    ChunkInfo* currentChunk = nullptr;
-    ChunkMap64* chunks = nullptr;
-    AppMap appsAccessMaps;
+    static AccessTable toAccessTable(const std::vector<long_id>& apps, std::vector<ChunkMap64> chunkMaps);
 };
 
 
@@ -160,8 +160,8 @@ int main(int argc, char const* argv[]) {
 
     auto response = processor.parallelExecuteRequests<Executor>();
 
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n",
-           response[0].httpResponse.c_str());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response[0].httpResponse.size()), response[0].httpResponse.data());
 
     std::cout << (std::string) *senderPage.getNative() << "\n";
     std::cout << (std::string) *recipientPage.getNative() << "\n";
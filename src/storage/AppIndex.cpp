@@ -15,49 +15,80 @@
 // You should have received a copy of the GNU Affero General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include "AppIndex.h"
 #include "core/info.h"
+#include "util/ThreadPool.hpp"
 
 using namespace argennon;
 using namespace asa;
 using namespace ascee::runtime;
-using std::vector, std::pair, std::future;
+using std::vector;
 
 // this function must be thread-safe
-AppTable AppIndex::buildAppTable(vector<long_id> sortedAppList) const {
-    vector<ascee::DispatcherPointer> dispatchers;
-    dispatchers.reserve(sortedAppList.size());
-    for (const auto& appID: sortedAppList) {
-        try {
-            dispatchers.push_back(cache.at(appID).dispatcherPtr);
-        } catch (const std::out_of_range&) {
-            throw BlockError("app:" + (std::string) appID + " was not declared in the block's call list");
+AppTable AppIndex::buildAppTable(const vector<long_id>& sortedAppList) const {
+    try {
+        return {dispatchTable, sortedAppList};
+    } catch (const std::out_of_range&) {
+        for (const auto& appID: sortedAppList) {
+            if (!cache.contains(appID)) {
+                throw BlockError("app:" + (std::string) appID + " was not declared in the block's call list");
+            }
         }
+        throw;
     }
-    return AppTable(util::OrderedStaticMap(std::move(sortedAppList), std::move(dispatchers)));
 }
 
 void AppIndex::prepareApps(const BlockInfo& block, const vector<long_id>& appList) {
     // Current implementation is not complete. In the complete implementation this function should also check that
     // the locally stored app is up-to-date and if it isn't it should download the up-to-date version from a PV-DB
     // server.
-    vector<pair<long_id, future<AppLoader::AppHandle>>> pendingHandles;
+    vector<long_id> newApps;
     for (const auto& appID: appList) {
-        if (!cache.contains(appID)) {
-            pendingHandles.emplace_back(appID, std::async(&AppLoader::load, loader, appID));
-        }
+        if (!cache.contains(appID)) newApps.emplace_back(appID);
     }
-    for (auto& pending: pendingHandles) {
+    vector<AppLoader::AppHandle> handles(newApps.size(), AppLoader::AppHandle{nullptr, 0, nullptr});
+    util::ThreadPool::global().parallelFor(int64_t(newApps.size()), [&](int64_t i) {
         try {
-            cache.try_emplace(pending.first, pending.second.get());
+            handles[i] = loader->load(newApps[i]);
         } catch (const std::runtime_error& err) {
             std::cerr << err.what() << '\n';
-            cache.try_emplace(pending.first, AppLoader::AppHandle{nullptr, 0, nullptr});
         }
-    }
+    });
+    for (std::size_t i = 0; i < newApps.size(); ++i) cache.try_emplace(newApps[i], handles[i]);
+
+    vector<long_id> appIDs;
+    appIDs.reserve(cache.size());
+    for (const auto& app: cache) appIDs.emplace_back(app.first);
+    // the map is only modified here, so other threads can update the costs without locking.
+    for (const auto& appID: appIDs) executionCosts.try_emplace(appID, 0);
+    std::sort(appIDs.begin(), appIDs.end());
+    vector<ascee::DispatcherPointer> dispatchers;
+    dispatchers.reserve(appIDs.size());
+    for (const auto& appID: appIDs) dispatchers.emplace_back(cache.at(appID).dispatcherPtr);
+    dispatchTable = std::make_shared<const DispatchTable>(
+            util::OrderedStaticMap(std::move(appIDs), std::move(dispatchers)));
+}
+
+int64_t AppIndex::getExecutionCost(long_id appID) const {
+    auto it = executionCosts.find(appID);
+    if (it == executionCosts.end()) return default_execution_cost;
+    auto cost = it->second.load(std::memory_order_relaxed);
+    return cost == 0 ? default_execution_cost : cost;
+}
+
+void AppIndex::recordExecutionCost(long_id appID, int64_t nanoseconds) {
+    auto it = executionCosts.find(appID);
+    if (it == executionCosts.end()) return;
+    // the cost is only an estimate, so losing an update because of a concurrent update is not important.
+    auto cost = it->second.load(std::memory_order_relaxed);
+    nanoseconds = std::max<int64_t>(nanoseconds, 1);
+    it->second.store(cost == 0 ? nanoseconds : cost + (nanoseconds - cost) / 8, std::memory_order_relaxed);
 }
 
-AppIndex::AppIndex(AppLoader* loader) : loader(loader) {}
+AppIndex::AppIndex(AppLoader* loader) :
+        dispatchTable(std::make_shared<const DispatchTable>(util::OrderedStaticMap<long_id, ascee::DispatcherPointer>())),
+        loader(loader) {}
 
 AppIndex::~AppIndex() {
     for (auto& app: cache) {
@@ -19,6 +19,7 @@
 #define ARG_CORE_APP_ASA_INDEX_H
 
 #include <vector>
+#include <atomic>
 #include "core/info.h"
 #include "executor/AppTable.h"
 #include "AppLoader.h"
@@ -39,18 +40,39 @@ public:
      * @param sortedAppList
      * @return
      */
-    ascee::runtime::AppTable buildAppTable(std::vector<long_id> sortedAppList) const;
+    ascee::runtime::AppTable buildAppTable(const std::vector<long_id>& sortedAppList) const;
 
     /**
      * Updates the applications included in @p appList in the internal cache, to the state of the provided @p block.
+     * Then a new DispatchTable is built, which will be shared by all app tables built after this call.
      * @note This function is not thread-safe.
      * @param block
      * @param appList
      */
     void prepareApps(const BlockInfo& block, const std::vector<long_id>& appList);
 
+    /**
+     * Returns the estimated execution time of a request which calls the app, in nanoseconds. For apps without any
+     * recorded execution, a default value is returned.
+     * @note This function is thread-safe.
+     */
+    [[nodiscard]]
+    int64_t getExecutionCost(long_id appID) const;
+
+    /**
+     * Updates the execution cost of an app using an exponential moving average. Executions of apps which are not
+     * prepared by prepareApps() are ignored.
+     * @note This function is thread-safe.
+     */
+    void recordExecutionCost(long_id appID, int64_t nanoseconds);
+
 private:
+    static constexpr int64_t default_execution_cost = 100000;
+
     std::unordered_map<uint64_t, AppLoader::AppHandle> cache;
+    /// execution costs are kept between blocks. A zero cost indicates that no execution is recorded for the app.
+    std::unordered_map<uint64_t, std::atomic<int64_t>> executionCosts;
+    std::shared_ptr<const ascee::runtime::DispatchTable> dispatchTable;
     AppLoader* loader;
 };
 
@@ -34,14 +34,23 @@ ChunkIndex::ChunkIndex(
         vector<pair<full_id, Page*>>&& writablePages,
         util::OrderedStaticMap<full_id, ChunkBoundsInfo>&& chunkBounds,
         int32_fast numOfChunks
-) : writablePages(std::move(writablePages)), sizeBoundsInfo(std::move(chunkBounds)) {
+) : ChunkIndex(std::move(chunkBounds), numOfChunks) {
+    indexPages(readonlyPages, std::move(writablePages));
+}
 
+ChunkIndex::ChunkIndex(util::OrderedStaticMap<full_id, ChunkBoundsInfo>&& chunkBounds, int32_fast numOfChunks) :
+        sizeBoundsInfo(std::move(chunkBounds)) {
     chunkIndex.reserve(numOfChunks);
+}
+
+void ChunkIndex::indexPages(const vector<pair<full_id, Page*>>& readonlyPages,
+                            vector<pair<full_id, Page*>>&& pages) {
+    writablePages = std::move(pages);
     for (const auto& page: readonlyPages) {
         indexPage(page, false);
     }
 
-    for (const auto& page: this->writablePages) {
+    for (const auto& page: writablePages) {
         indexPage(page, true);
     }
 
@@ -53,13 +62,18 @@ ChunkIndex::ChunkIndex(
 }
 
 RestrictedModifier ChunkIndex::buildModifier(const AppRequestInfo::AccessMapType& rawAccessMap) {
-    vector<RestrictedModifier::ChunkMap64> chunkMapList;
-    chunkMapList.reserve(rawAccessMap.size());
+    std::size_t chunkCount = 0, blockCount = 0;
+    for (const auto& chunkMap: rawAccessMap.getValues()) {
+        chunkCount += chunkMap.size();
+        for (const auto& accessBlocks: chunkMap.getValues()) blockCount += accessBlocks.size();
+    }
+
+    // all chunks and access blocks of the request are stored in a single contiguous table.
+    RestrictedModifier::AccessTable table(rawAccessMap.size(), chunkCount, blockCount);
     for (long i = 0; i < rawAccessMap.size(); ++i) {
         auto appID = rawAccessMap.getKeys()[i];
         auto& chunkMap = rawAccessMap.getValues()[i];
-        vector<RestrictedModifier::ChunkInfo> chunkInfoList;
-        chunkInfoList.reserve(chunkMap.size());
+        table.addApp(appID);
         for (long j = 0; j < chunkMap.size(); ++j) {
             auto chunkLocalID = chunkMap.getKeys()[j];
             // When the chunk is not found getChunk throws a BlockError exception.
@@ -94,17 +108,14 @@ RestrictedModifier ChunkIndex::buildModifier(const AppRequestInfo::AccessMapType
                 }
             }
 
-            chunkInfoList.emplace_back(
-                    chunkPtr,
-                    resizingType,
-                    chunkNewSize,
-                    chunkMap.getValues()[j].getKeys(),
-                    chunkMap.getValues()[j].getValues()
-            );
+            table.addChunk(chunkMap.getKeys()[j], chunkPtr, resizingType, chunkNewSize);
+            auto& accessBlocks = chunkMap.getValues()[j];
+            for (long k = 0; k < accessBlocks.size(); ++k) {
+                table.addBlock(accessBlocks.getKeys()[k], accessBlocks.getValues()[k]);
+            }
         }
-        chunkMapList.emplace_back(chunkMap.getKeys(), std::move(chunkInfoList));
     }
-    return {rawAccessMap.getKeys(), std::move(chunkMapList)};
+    return RestrictedModifier(std::move(table));
 }
 
 Chunk* ChunkIndex::getChunk(const full_id& id) {
@@ -39,6 +39,17 @@ public:
             int32_fast numOfChunks
     );
 
+    /**
+     * Creates an index which only contains the proposed size bounds of chunks. Size bounds can be used before pages
+     * are indexed, but chunks are not accessible until indexPages() is called.
+     */
+    ChunkIndex(util::OrderedStaticMap <full_id, ChunkBoundsInfo>&& chunkBounds, int32_fast numOfChunks);
+
+    void indexPages(
+            const std::vector<std::pair<full_id, Page*>>& readonlyPages,
+            std::vector<std::pair<full_id, Page*>>&& writablePages
+    );
+
     /// this function must be thread-safe
     Chunk* getChunk(const full_id& id);;
 
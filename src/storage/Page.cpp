@@ -34,7 +34,7 @@ void Page::applyDelta(const VarLenFullID& pageID, const Page::Delta& delta, int6
     while (auto indexDiff = var_uint_trie_g.decodeVarUInt(&reader, end)) {
         index += indexDiff;
         if (index == migrants.size()) {
-            migrants.emplace_back(VarLenFullID(&reader, end));
+            migrants.emplace_back(VarLenFullID(&reader, end)).added = false;
         } else {
             if (*reader == 0) throw std::runtime_error("chunk removal not implemented");
             migrants.at(index).id = VarLenFullID(&reader, end);
@@ -59,6 +59,31 @@ void Page::applyDelta(const VarLenFullID& pageID, const Page::Delta& delta, int6
     version = blockNumber;
 }
 
+Page::Delta Page::createDelta(const VarLenFullID& pageID) {
+    Delta delta;
+    auto& content = delta.content;
+    int32_fast lastIndex = -1;
+    for (int32_fast i = 0; i < migrants.size(); ++i) {
+        if (!migrants[i].added) continue;
+        var_uint_trie_g.appendVarUInt(content, i - lastIndex);
+        content.insert(content.end(), migrants[i].id.getBinary(), migrants[i].id.getBinary() + migrants[i].id.getLen());
+        lastIndex = i;
+    }
+    var_uint_trie_g.appendVarUInt(content, 0);
+
+    auto keysDigest = DigestCalculator();
+    native->writeDelta(content);
+    keysDigest << pageID << native->calculateDigest();
+    for (auto& m: migrants) {
+        // the receiver of the delta has an empty chunk for a new migrant.
+        m.chunk->writeDelta(content, m.added);
+        m.added = false;
+        keysDigest << m.id << m.chunk->calculateDigest();
+    }
+    delta.finalDigest = keysDigest.CalculateDigest();
+    return delta;
+}
+
 Page::Migrant Page::extractMigrant(int32_fast index) {
     try {
         // todo needs optimization
@@ -40,6 +40,8 @@ public:
     struct Migrant {
         VarLenFullID id;
         std::unique_ptr<Chunk> chunk;
+        /// indicates that the migrant was added to the page after the last delta was created or applied.
+        bool added = true;
 
         Migrant(VarLenFullID id, Chunk* chunk) : id(std::move(id)), chunk(chunk) {}
 
@@ -71,6 +73,15 @@ public:
 
     void applyDelta(const VarLenFullID& pageID, const Delta& delta, int64_fast blockNumber);
 
+    /**
+     * Creates a delta, in the format accepted by applyDelta(), containing the modifications of the page since the
+     * last delta was created or applied. Modified ranges of chunks are recorded during execution by
+     * Chunk::markModified(), so creating a delta does not need to compare chunks.
+     *
+     * @note Removing migrants can not be represented by deltas yet.
+     */
+    Delta createDelta(const VarLenFullID& pageID);
+
     [[nodiscard]]
     Chunk* getNative();
 
@@ -39,40 +39,78 @@ PageCache::PageCache(PageLoader& loader) : loader(loader) {
 vector<pair<full_id, Page*>>
 PageCache::preparePages(const BlockInfo& block, vector<VarLenFullID>&& pageAccessList,
                         const vector<MigrationInfo>& chunkMigrations) {
+    auto result = fetchPages(block, pageAccessList, [](const VarLenFullID&) { return false; });
+    completePages(block, pageAccessList, result, chunkMigrations);
+    return result;
+}
+
+vector<pair<full_id, Page*>>
+PageCache::fetchPages(const BlockInfo& block, const vector<VarLenFullID>& pageAccessList,
+                      const std::function<bool(const VarLenFullID&)>& isDeferred) {
     vector<pair<full_id, Page*>> result;
     result.reserve(pageAccessList.size());
-    for (const auto& pageID: pageAccessList) {
-        auto& page = cache.try_emplace(pageID, block.blockNumber).first->second;
-        result.emplace_back(pageID, &page);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        for (const auto& pageID: pageAccessList) {
+            if (isDeferred(pageID)) {
+                result.emplace_back(pageID, nullptr);
+                continue;
+            }
+            auto& [id, page] = *cache.try_emplace(pageID, block.blockNumber).first;
+            pageIDs.try_emplace(&page, &id);
+            result.emplace_back(pageID, &page);
+        }
     }
 
     // Building the request that will be sent to the PV-DB server
     loader.setCurrentBlock(block);
     for (const auto& pair: result) {
-        loader.preparePage(pair.first, *pair.second);
+        if (pair.second != nullptr) loader.preparePage(pair.first, *pair.second);
     }
 
     // Downloading and updating required pages
     for (int i = 0; i < pageAccessList.size(); ++i) {
         //todo: this should be done using async
-        loader.updatePage(pageAccessList[i], *result[i].second);
+        if (result[i].second != nullptr) loader.updatePage(pageAccessList[i], *result[i].second);
+    }
+    return result;
+}
+
+void PageCache::completePages(const BlockInfo& block, const vector<VarLenFullID>& pageAccessList,
+                              vector<pair<full_id, Page*>>& pages, const vector<MigrationInfo>& chunkMigrations) {
+    vector<VarLenFullID> deferredList;
+    vector<std::size_t> deferredIndices;
+    for (std::size_t i = 0; i < pages.size(); ++i) {
+        if (pages[i].second == nullptr) {
+            deferredList.emplace_back(pageAccessList[i]);
+            deferredIndices.emplace_back(i);
+        }
+    }
+
+    if (!deferredList.empty()) {
+        auto fetched = fetchPages(block, deferredList, [](const VarLenFullID&) { return false; });
+        for (std::size_t i = 0; i < fetched.size(); ++i) pages[deferredIndices[i]].second = fetched[i].second;
     }
 
     // Applying proposed chunk migrations
     for (const auto& migration: chunkMigrations) {
-        Page* from = result.at(migration.fromIndex).second;
-        Page* to = result.at(migration.toIndex).second;
+        Page* from = pages.at(migration.fromIndex).second;
+        Page* to = pages.at(migration.toIndex).second;
         auto migrant = migration.chunkIndex == -1 ?
-                       Page::Migrant(std::move(pageAccessList[migration.fromIndex]), from->getNative()) :
+                       Page::Migrant(pageAccessList.at(migration.fromIndex), from->getNative()) :
                        from->extractMigrant(migration.chunkIndex);
 
         to->addMigrant(std::move(migrant));
     }
-
-    return result;
 }
 
-void PageCache::commit(vector<pair<full_id, Page*>> modifiedPages) {
-
+vector<pair<full_id, Page::Delta>> PageCache::commit(const vector<pair<full_id, Page*>>& modifiedPages) {
+    vector<pair<full_id, Page::Delta>> deltas;
+    deltas.reserve(modifiedPages.size());
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (const auto& [id, page]: modifiedPages) {
+        deltas.emplace_back(id, page->createDelta(*pageIDs.at(page)));
+    }
+    return deltas;
 }
 
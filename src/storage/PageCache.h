@@ -19,6 +19,8 @@
 #define ARGENNON_PAGE_CACHE_H
 
 
+#include <functional>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -29,6 +31,8 @@
 namespace argennon::asa {
 
 //TODO: Heap must be signal-safe but it does not need to be thread-safe
+/// Fetching pages for a block can be done concurrently with committing the pages of another block. Other functions
+/// must not be called concurrently.
 class PageCache {
 public:
     explicit PageCache(PageLoader& loader);
@@ -42,7 +46,32 @@ public:
             const std::vector<MigrationInfo>& chunkMigrations
     );
 
-    void commit(std::vector<std::pair<full_id, Page*>> modifiedPages);
+    /**
+     * Downloads and updates the pages of @p pageAccessList, except the pages for which @p isDeferred returns true. The
+     * page pointer of a deferred page will be nullptr in the returned list, and the page can be fetched later by
+     * completePages(). This is used for fetching the pages of a block while the previous block is still being
+     * executed.
+     */
+    std::vector<std::pair<full_id, Page*>>
+    fetchPages(
+            const BlockInfo& block,
+            const std::vector<VarLenFullID>& pageAccessList,
+            const std::function<bool(const VarLenFullID&)>& isDeferred
+    );
+
+    /**
+     * Fetches the deferred pages of a list returned by fetchPages() and applies the proposed chunk migrations.
+     * @param pages the list returned by fetchPages() for @p pageAccessList.
+     */
+    void completePages(
+            const BlockInfo& block,
+            const std::vector<VarLenFullID>& pageAccessList,
+            std::vector<std::pair<full_id, Page*>>& pages,
+            const std::vector<MigrationInfo>& chunkMigrations
+    );
+
+    /// creates the deltas of modified pages at the end of a block, which can be persisted or sent to peers.
+    std::vector<std::pair<full_id, Page::Delta>> commit(const std::vector<std::pair<full_id, Page*>>& modifiedPages);
 
     /**
      * in a usual implementation this function simply removes any page that is modified.
@@ -52,7 +81,10 @@ public:
 
 private:
     std::unordered_map<VarLenFullID, Page, VarLenFullID::Hash> cache;
+    /// the identifiers of cached pages. Elements of an unordered_map are never moved, so keeping pointers is safe.
+    std::unordered_map<const Page*, const VarLenFullID*> pageIDs;
     PageLoader& loader;
+    std::mutex cacheMutex;
 };
 
 } // namespace argennon::asa
@@ -21,6 +21,9 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 namespace argennon::util {
 
@@ -53,6 +56,26 @@ public:
         return result;
     }
 
+    /**
+     * Waits until the queue has at least one item and dequeues up to @p maxCount items. When more items are available,
+     * only a fair share of them, considering @p consumerCount consumers, is dequeued. Unlike the single item version
+     * the caller is counted as a producer at most once per call.
+     */
+    void blockingDequeue(std::vector<T>& out, size_t maxCount, size_t consumerCount, bool addProducer) {
+        std::unique_lock<std::mutex> lk(queueMutex);
+        cv.wait(lk, [this] { return !(content.empty() && producerCount > 0); });
+        if (content.empty()) throw std::underflow_error("empty queue without any producers");
+
+        if (addProducer) ++producerCount;
+
+        size_t fairShare = (content.size() + consumerCount - 1) / std::max<size_t>(consumerCount, 1);
+        size_t count = std::min(maxCount, std::max<size_t>(fairShare, 1));
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(content.front());
+            content.pop();
+        }
+    }
+
     /**
      * Use with caution. In many situations instead of this function @p addProducer flag of @p blockingDequeue
      * should be used.
@@ -18,11 +18,12 @@
 #ifndef ARGENNON_UTIL_FIXED_ORDERED_MAP_H
 #define ARGENNON_UTIL_FIXED_ORDERED_MAP_H
 
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <memory>
 #include <functional>
-#include <future>
+#include "ThreadPool.hpp"
 
 namespace argennon::util {
 
@@ -41,8 +42,8 @@ public:
         if (this->keys.size() != this->values.size()) {
             throw std::invalid_argument("size mismatch in keys and values");
         }
-        this->keys.shrink_to_fit();
-        this->values.shrink_to_fit();
+        // We do not call shrink_to_fit() here. Most maps are small and short-lived, and reallocating them costs more
+        // than the memory that could be saved.
     }
 
     V& at(const K& key) {
@@ -55,14 +56,47 @@ public:
 
     static
     std::size_t find(const std::vector<K>& sortedKeys, const K& key) {
-        std::size_t begin = 0, mid;
-        auto end = sortedKeys.size();
-        while ((mid = (begin + end) >> 1) < end) {
-            if (key == sortedKeys[mid]) return mid;
-            else if (key < sortedKeys[mid]) end = mid;
-            else begin = mid + 1;
+        auto index = search(sortedKeys, key);
+        if (index < 0) throw std::out_of_range("key not found");
+        return index;
+    }
+
+    /// a non-throwing version of find(). It returns -1 when @p key is not found.
+    static
+    long search(const std::vector<K>& sortedKeys, const K& key) {
+        const K* first = sortedKeys.data();
+        auto length = sortedKeys.size();
+        if constexpr (std::is_arithmetic_v<K>) {
+            if (length <= simd_search_limit) {
+                // Counting the keys that are less than key needs no early exit, so the compiler can vectorize the
+                // comparisons. The count is the index of the first key which is not less than key.
+                std::size_t index = 0;
+                for (std::size_t i = 0; i < length; ++i) index += first[i] < key;
+                return index < length && first[index] == key ? long(index) : -1;
+            }
+        }
+        if (length <= linear_search_limit) {
+            // most maps have only a few keys, and for them a linear scan is faster than any kind of binary search.
+            for (std::size_t i = 0; i < length; ++i) {
+                if (!(first[i] < key)) return first[i] == key ? long(i) : -1;
+            }
+            return -1;
         }
-        throw std::out_of_range("key not found");
+        // A branchless lower bound search: the loop always runs log2(length) times and the selection of the half can
+        // be compiled to a conditional move, so there is no branch misprediction.
+        const K* base = first;
+        while (length > 1) {
+            auto half = length >> 1;
+            base = base[half - 1] < key ? base + half : base;
+            length -= half;
+        }
+        return *base == key ? long(base - first) : -1;
+    }
+
+    /// returns the index of @p key in the map or -1 if the map does not contain @p key.
+    [[nodiscard]]
+    long indexOf(const K& key) const {
+        return search(keys, key);
     }
 
     [[nodiscard]] long size() const {
@@ -128,6 +162,9 @@ public:
     }
 
 private:
+    static constexpr std::size_t linear_search_limit = 8;
+    static constexpr std::size_t simd_search_limit = 16;
+
     std::vector<K> keys;
     std::vector<V> values;
 
@@ -167,9 +204,12 @@ OrderedStaticMap<K, V> mergeIntervalParallel(std::vector<OrderedStaticMap<K, V>>
                mergeIntervalParallel(maps, (begin + end) / 2, end, k);
     }
 
-    auto secondHalf = std::async([&]() { return mergeIntervalParallel(maps, (begin + end) / 2, end, k); });
-    auto&& firstHalf = mergeIntervalParallel(maps, begin, (begin + end) / 2, k);
-    return move(firstHalf) | secondHalf.get();
+    OrderedStaticMap<K, V> firstHalf, secondHalf;
+    ThreadPool::global().forkJoin(
+            [&] { firstHalf = mergeIntervalParallel(maps, begin, (begin + end) / 2, k); },
+            [&] { secondHalf = mergeIntervalParallel(maps, (begin + end) / 2, end, k); }
+    );
+    return move(firstHalf) | move(secondHalf);
 }
 
 /// Calculates: maps[begin] | maps[begin + 1] | maps[begin + 2] | ... | map[end - 1], where | operator merges two maps.
@@ -18,10 +18,12 @@
 #ifndef ARGENNON_IDENTIFIER_TRIE_H
 #define ARGENNON_IDENTIFIER_TRIE_H
 
+#include <charconv>
 #include <string>
 #include <stdexcept>
 #include <array>
 #include <cstring>
+#include <vector>
 
 namespace argennon::util {
 
@@ -151,6 +153,14 @@ public:
         throw std::overflow_error("encodeVarUInt: value too large");
     }
 
+    /// encodes @p value using encodeVarUInt() and appends the big-endian representation of the code to @p dest.
+    void appendVarUInt(std::vector<byte>& dest, T value) const {
+        int32_t len;
+        auto code = encodeVarUInt(value, &len);
+        dest.resize(dest.size() + len);
+        writeBigEndian(dest.data() + dest.size() - len, code, len);
+    }
+
     /**
      *
      * @tparam U can be a byte* containing a big-endian representation of the prefix-code or a data type containing
@@ -226,11 +236,21 @@ public:
     }
 
     std::string toDecimalStr(const T code) const {
-        std::string ret;
+        char buf[4 * height];
+        return {buf, std::size_t(toDecimal(code, buf))};
+    }
+
+    /**
+     * Writes the decimal representation of @p code into @p dest without allocating memory.
+     * @param dest must have room for at least `4 * height` characters.
+     * @return the number of written characters.
+     */
+    int toDecimal(const T code, char* dest) const {
+        char* end = dest;
         for (int i = 0; i < height; ++i) {
-            ret += std::to_string(byte(code >> ((sizeof(T) - i - 1) * 8)));
-            if (code < boundary[i]) return ret;
-            ret += ".";
+            end = std::to_chars(end, end + 3, unsigned(byte(code >> ((sizeof(T) - i - 1) * 8)))).ptr;
+            if (code < boundary[i]) return int(end - dest);
+            *end++ = '.';
         }
         throw std::out_of_range("toDecimalStr: invalid identifier");
     }
@@ -0,0 +1,189 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ARGENNON_UTIL_THREAD_POOL_H
+#define ARGENNON_UTIL_THREAD_POOL_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace argennon::util {
+
+/**
+ * A pool of long-lived threads which is shared by all parallel stages of block validation, so no threads are created
+ * or destroyed during the validation of a block.
+ *
+ * Work is submitted as fork-join jobs. The calling thread always takes part in its job, and it runs every part of the
+ * job that is not started by a pool thread. As a result, a job never waits for work that is queued behind other jobs,
+ * and jobs can be nested or submitted from pool threads without any risk of deadlock.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threadCount when it is less than one, the number of hardware threads is used.
+     * @param pinned when true, every thread is pinned to a single core.
+     */
+    explicit ThreadPool(int threadCount = 0, bool pinned = false) {
+        if (threadCount < 1) threadCount = hardwareThreads();
+        threads.reserve(threadCount);
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back([this] { run(); });
+            if (pinned) pin(threads.back(), i);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopped = true;
+        }
+        cv.notify_all();
+        for (auto& t: threads) t.join();
+    }
+
+    /// returns the pool shared by validation stages. The pool is created by the first call using its arguments.
+    static ThreadPool& global(int threadCount = 0, bool pinned = false) {
+        // The pool is intentionally leaked: its threads should not be joined during static destruction.
+        static auto* pool = new ThreadPool(threadCount, pinned);
+        return *pool;
+    }
+
+    [[nodiscard]]
+    int size() const { return int(threads.size()); }
+
+    /**
+     * Calls @p body(i) for every i in [0, count) and returns when all calls are finished. Indices are processed in
+     * chunks of @p grain indices. If a call throws an exception, the remaining chunks are skipped and the first
+     * exception is rethrown.
+     */
+    template<typename Body>
+    void parallelFor(int64_t count, Body&& body, int64_t grain = 1) {
+        if (count <= 0) return;
+        grain = std::max<int64_t>(grain, 1);
+        auto job = std::make_shared<Job>(count, grain, [&body](int64_t i) { body(i); });
+
+        auto helpers = std::min<int64_t>((count + grain - 1) / grain - 1, size());
+        if (helpers > 0) {
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                for (int64_t i = 0; i < helpers; ++i) queue.emplace_back([job] { job->work(); });
+            }
+            if (helpers == 1) cv.notify_one();
+            else cv.notify_all();
+        }
+        job->work();
+        job->wait();
+        if (job->error) std::rethrow_exception(job->error);
+    }
+
+    /// runs @p functions in parallel, and returns when all of them are finished.
+    template<typename... F>
+    void forkJoin(F&& ... functions) {
+        std::array<std::function<void()>, sizeof...(F)> tasks{std::function<void()>(std::ref(functions))...};
+        parallelFor(int64_t(tasks.size()), [&tasks](int64_t i) { tasks[i](); });
+    }
+
+private:
+    class Job {
+    public:
+        Job(int64_t count, int64_t grain, std::function<void(int64_t)> body) :
+                count(count), grain(grain), body(std::move(body)) {}
+
+        void work() {
+            while (true) {
+                auto begin = next.fetch_add(grain);
+                // A pool thread may start after the job is finished, but then it will never call body.
+                if (begin >= count) return;
+                auto end = std::min(begin + grain, count);
+                if (!failed.load(std::memory_order_relaxed)) {
+                    try {
+                        for (auto i = begin; i < end; ++i) body(i);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        if (!error) error = std::current_exception();
+                        failed = true;
+                    }
+                }
+                if (finished.fetch_add(end - begin) + (end - begin) == count) finished.notify_all();
+            }
+        }
+
+        void wait() {
+            for (auto f = finished.load(); f < count; f = finished.load()) finished.wait(f);
+        }
+
+        std::exception_ptr error;
+
+    private:
+        const int64_t count;
+        const int64_t grain;
+        const std::function<void(int64_t)> body;
+        std::atomic<int64_t> next = 0;
+        std::atomic<int64_t> finished = 0;
+        std::atomic<bool> failed = false;
+        std::mutex errorMutex;
+    };
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> queue;
+    std::mutex queueMutex;
+    std::condition_variable cv;
+    bool stopped = false;
+
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                cv.wait(lock, [this] { return stopped || !queue.empty(); });
+                if (queue.empty()) return;
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            task();
+        }
+    }
+
+    static int hardwareThreads() {
+        return std::max(1, int(std::thread::hardware_concurrency()));
+    }
+
+    static void pin(std::thread& t, int index) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % hardwareThreads(), &set);
+        // pinning is only an optimization, so failures are ignored.
+        pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+    }
+};
+
+} // namespace argennon::util
+#endif // ARGENNON_UTIL_THREAD_POOL_H
@@ -48,11 +48,11 @@
 #define ERROR_INVALID_LENGTH 2
 #define ERROR_INVALID_CHARACTER 3
 
+#include <charconv>
 #include <cstdint>
 #include <stdexcept>
 #include <cassert>
 #include <cstring>
-#include <sstream>
 #include "encoding.h"
 
 typedef int error_t;
@@ -330,7 +330,12 @@ void util::memSet(void* dest, int value, size_type n) {
 }
 
 std::string util::toHex(uint64_t value) {
-    std::stringstream buf;
-    buf << "0x" << std::hex << value;
-    return {buf.str()};
+    char buf[18];
+    return {buf, toHex(value, buf)};
+}
+
+util::size_type util::toHex(uint64_t value, char* dest) {
+    dest[0] = '0';
+    dest[1] = 'x';
+    return std::to_chars(dest + 2, dest + 18, value, 16).ptr - dest;
 }
@@ -39,5 +39,9 @@ void memSet(void* dest, int value, size_type n);
 
 std::string toHex(uint64_t value);
 
+/// writes the hex representation of @p value into @p dest, which must have room for at least 18 characters. The
+/// number of written characters is returned.
+size_type toHex(uint64_t value, char* dest);
+
 } // namespace argennon::util
 #endif // ARGENNON_UTIL_ENCODING_H
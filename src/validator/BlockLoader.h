@@ -27,6 +27,7 @@
 
 namespace argennon::ave {
 
+/// Loads the content of blocks. Functions are virtual, so the source of blocks can be replaced.
 class BlockLoader {
 public:
     class RequestStream {
@@ -34,41 +35,52 @@ public:
         class EndOfStream : std::exception {
         };
 
+        RequestStream() = default;
+
+        explicit RequestStream(std::vector<AppRequestInfo> requests) : requests(std::move(requests)) {}
+
         AppRequestInfo next() {
-            return {};
+            if (current >= requests.size()) throw EndOfStream();
+            return std::move(requests[current++]);
         }
+
+    private:
+        std::vector<AppRequestInfo> requests;
+        std::size_t current = 0;
     };
 
-    std::vector<RequestStream> createRequestStreams(int count) {
+    virtual ~BlockLoader() = default;
+
+    virtual std::vector<RequestStream> createRequestStreams(int count) {
         return {};
     }
 
-    void setCurrentBlock(const BlockInfo& b) {};
+    virtual void setCurrentBlock(const BlockInfo& b) {};
 
-    AppRequestInfo loadRequest(AppRequestIdType id) { return {}; };
+    virtual AppRequestInfo loadRequest(AppRequestIdType id) { return {}; };
 
     // BlockLoader must verify this value.
-    int32_fast getNumOfRequests() { return 0; };
+    virtual int32_fast getNumOfRequests() { return 0; };
 
     /// This list includes:
     ///     1) The id of pages that contain at least one chunk needed for validating the block
     ///     2) The id of non-existent chunks that are accessed by at least one request.
-    std::vector<VarLenFullID> getReadonlyPageList() { return {}; };
+    virtual std::vector<VarLenFullID> getReadonlyPageList() { return {}; };
 
-    std::vector<VarLenFullID> getWritablePageList() { return {}; };
+    virtual std::vector<VarLenFullID> getWritablePageList() { return {}; };
 
     /// This list will not include all chunks. Only expandable chunks and accessed non-existent chunks should be
     /// included.
-    util::OrderedStaticMap<full_id, ChunkBoundsInfo> getProposedSizeBounds() { return {}; };
+    virtual util::OrderedStaticMap<full_id, ChunkBoundsInfo> getProposedSizeBounds() { return {}; };
 
     // BlockLoader does NOT need to verify this value. (only affects performance)
-    int32_fast getNumOfChunks() {
+    virtual int32_fast getNumOfChunks() {
         return 0;
     }
 
-    std::vector<MigrationInfo> getMigrationList() { return {}; };
+    virtual std::vector<MigrationInfo> getMigrationList() { return {}; };
 
-    Digest getResponseListDigest() {
+    virtual Digest getResponseListDigest() {
         return {};
     }
 };
@@ -15,51 +15,132 @@
 // You should have received a copy of the GNU Affero General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
-#include <future>
 #include "BlockValidator.h"
 #include "RequestProcessor.hpp"
+#include "util/ThreadPool.hpp"
 
 using namespace argennon;
 using namespace ave;
 using namespace util;
 using namespace asa;
-using std::vector, std::future, ascee::runtime::AppResponse;
+using std::vector, ascee::runtime::AppResponse;
 
 static
-Digest calculateDigest(vector<AppResponse> responses) {
+Digest calculateDigest(const vector<AppResponse>& responses) {
     return {};
 }
 
+/// A block of a chain which is being validated. The request processor keeps a reference to the chunk index of the
+/// block, so pending blocks are allocated on heap and are never moved.
+struct BlockValidator::PendingBlock {
+    PendingBlock(BlockLoader& loader, const BlockInfo& previous, AppIndex& appIndex, int workersCount) :
+            previous(previous),
+            readonlyList(loader.getReadonlyPageList()),
+            writableList(loader.getWritablePageList()),
+            migrations(loader.getMigrationList()),
+            responseDigest(loader.getResponseListDigest()),
+            chunkIndex(loader.getProposedSizeBounds(), loader.getNumOfChunks()),
+            processor(chunkIndex, appIndex, loader.getNumOfRequests(), workersCount) {}
+
+    BlockInfo previous;
+    vector<VarLenFullID> readonlyList;
+    vector<VarLenFullID> writableList;
+    vector<MigrationInfo> migrations;
+    Digest responseDigest;
+    /// pages that are written by the previous block are null until the block is bound.
+    vector<std::pair<full_id, Page*>> readonlyPages;
+    vector<std::pair<full_id, Page*>> writablePages;
+    ChunkIndex chunkIndex;
+    RequestProcessor processor;
+    /// the exception thrown while the block was being prepared. It will be rethrown when the block is bound.
+    std::exception_ptr failure;
+};
+
 /// Conditionally validates a block: valid(current | previous). Returns true when the block is valid and false
 /// if the block is not valid.
 /// Throwing an exception indicates that due to an internal error checking the validity of the block was not possible.
 bool BlockValidator::conditionalValidate(const BlockInfo& current, const BlockInfo& previous) {
-    try {
-        blockLoader.setCurrentBlock(current);
+    return validateChain({current}, previous) == 1;
+}
 
-        ChunkIndex chunkIndex(
-                cache.preparePages(previous, blockLoader.getReadonlyPageList(), blockLoader.getMigrationList()),
-                cache.preparePages(previous, blockLoader.getWritablePageList(), blockLoader.getMigrationList()),
-                blockLoader.getProposedSizeBounds(),
-                blockLoader.getNumOfChunks()
-        );
+std::size_t BlockValidator::validateChain(const vector<BlockInfo>& blocks, const BlockInfo& previous) {
+    if (blocks.empty()) return 0;
 
-        RequestProcessor processor(chunkIndex, appIndex, blockLoader.getNumOfRequests(), workersCount);
+    auto next = prepare(blocks[0], previous, {});
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        auto current = std::move(next);
+        bool valid = false;
+        try {
+            bind(*current);
+            if (i + 1 < blocks.size()) {
+                // the next block is prepared while the current block is being executed. Both stages run on the
+                // thread pool, and if no pool thread is free this thread runs them one after another.
+                PageSet writtenPages(current->writableList.begin(), current->writableList.end());
+                ThreadPool::global().forkJoin(
+                        [&] { next = prepare(blocks[i + 1], blocks[i], writtenPages); },
+                        [&] { valid = execute(*current); }
+                );
+            } else {
+                valid = execute(*current);
+            }
+        } catch (const BlockError& err) {
+            std::cout << err.message << std::endl;
+        }
 
-        processor.loadRequests(blockLoader.createRequestStreams(workersCount));
+        if (!valid) {
+            // the next block is conditioned on an invalid block, so the pages fetched for it must be discarded too.
+            if (next) {
+                cache.rollback(next->readonlyList);
+                cache.rollback(next->writableList);
+            }
+            cache.rollback(current->writableList);
+            return i;
+        }
+    }
+    return blocks.size();
+}
 
-        processor.checkDependencyGraph();
+/// Fetches the pages of a block, decodes its requests and verifies its dependency graph. The pages in
+/// @p runningBlockPages are being written by the executing block, and they will be fetched when the block is bound.
+std::unique_ptr<BlockValidator::PendingBlock>
+BlockValidator::prepare(const BlockInfo& current, const BlockInfo& previous, const PageSet& runningBlockPages) {
+    blockLoader.setCurrentBlock(current);
+    auto block = std::make_unique<PendingBlock>(blockLoader, previous, appIndex, workersCount);
+    try {
+        auto isDeferred = [&](const VarLenFullID& pageID) { return runningBlockPages.contains(pageID); };
+        ThreadPool::global().forkJoin(
+                [&] {
+                    block->readonlyPages = cache.fetchPages(previous, block->readonlyList, isDeferred);
+                    block->writablePages = cache.fetchPages(previous, block->writableList, isDeferred);
+                },
+                [&] {
+                    block->processor.decodeRequests(blockLoader.createRequestStreams(workersCount));
+                    block->processor.checkDependencyGraph();
+                }
+        );
+    } catch (...) {
+        block->failure = std::current_exception();
+    }
+    return block;
+}
 
-        auto responses = processor.parallelExecuteRequests<ascee::runtime::Executor>();
+/// Binds a prepared block to the heap. The previous block must be committed before calling this function.
+void BlockValidator::bind(PendingBlock& block) {
+    if (block.failure) std::rethrow_exception(block.failure);
 
-        cache.commit(chunkIndex.getModifiedPages());
+    // proposed migrations only move chunks of writable pages.
+    cache.completePages(block.previous, block.readonlyList, block.readonlyPages, {});
+    cache.completePages(block.previous, block.writableList, block.writablePages, block.migrations);
+    block.chunkIndex.indexPages(block.readonlyPages, std::move(block.writablePages));
+    block.processor.bindRequests();
+}
 
-        return calculateDigest(responses) == blockLoader.getResponseListDigest();
-    } catch (const BlockError& err) {
-        std::cout << err.message << std::endl;
-        cache.rollback(blockLoader.getWritablePageList());
-        return false;
-    }
+bool BlockValidator::execute(PendingBlock& block) {
+    auto responses = block.processor.parallelExecuteRequests<ascee::runtime::Executor>();
+
+    cache.commit(block.chunkIndex.getModifiedPages());
+
+    return calculateDigest(responses) == block.responseDigest;
 }
 
 BlockValidator::BlockValidator(
@@ -18,6 +18,8 @@
 #ifndef NODE_BLOCK_VALIDATOR_H
 #define NODE_BLOCK_VALIDATOR_H
 
+#include <unordered_set>
+
 #include "RequestScheduler.h"
 #include "BlockLoader.h"
 #include "storage/PageCache.h"
@@ -34,11 +36,33 @@ public:
 
     bool conditionalValidate(const BlockInfo& current, const BlockInfo& previous);
 
+    /**
+     * Validates a chain of blocks, where every block is conditioned on its previous block in the chain and the first
+     * block is conditioned on @p previous. Validation is pipelined: while a block is being executed, the pages of the
+     * next block are fetched, its requests are decoded and its dependency graph is verified. Pages that are written
+     * by the executing block are fetched after the block is committed.
+     *
+     * Validation stops at the first invalid block.
+     * @return the number of valid blocks at the start of the chain.
+     */
+    std::size_t validateChain(const std::vector<BlockInfo>& blocks, const BlockInfo& previous);
+
 private:
+    using PageSet = std::unordered_set<VarLenFullID, VarLenFullID::Hash>;
+
+    struct PendingBlock;
+
     asa::PageCache& cache;
     BlockLoader& blockLoader;
     int workersCount = -1;
     asa::AppIndex appIndex;
+
+    std::unique_ptr<PendingBlock>
+    prepare(const BlockInfo& current, const BlockInfo& previous, const PageSet& runningBlockPages);
+
+    void bind(PendingBlock& block);
+
+    bool execute(PendingBlock& block);
 };
 
 } // namespace argennon::ave
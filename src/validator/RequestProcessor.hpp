@@ -18,21 +18,30 @@
 #ifndef ARGENNON_AVE_REQUEST_PROCESSOR_H
 #define ARGENNON_AVE_REQUEST_PROCESSOR_H
 
+#include <algorithm>
 #include <vector>
+#include <chrono>
+#include <optional>
+#include <unordered_map>
 #include "RequestScheduler.h"
+#include "util/ThreadPool.hpp"
 
 namespace argennon::ave {
 
 
 class RequestProcessor {
 public:
+    static constexpr int max_batch_size = 16;
+
     RequestProcessor(
             asa::ChunkIndex& chunkIndex,
             asa::AppIndex& appIndex,
             int32_fast numOfRequests,
             int workersCount = -1
-    ) : scheduler(numOfRequests, chunkIndex, appIndex), numOfRequests(numOfRequests),
-        workersCount(workersCount < 1 ? (int) std::thread::hardware_concurrency() * 2 : workersCount) {
+    ) : scheduler(numOfRequests, chunkIndex, appIndex), appIndex(appIndex), numOfRequests(numOfRequests),
+        workersCount(workersCount < 1 ? (int) std::thread::hardware_concurrency() * 2 : workersCount),
+        // a slab can not be empty, so a block without any requests still gets room for one response.
+        responseSlab(std::max<int32_fast>(numOfRequests, 1) * ascee::runtime::ResponseSlab::max_response_size) {
     }
 
 
@@ -52,6 +61,36 @@ public:
             } catch (const typename RequestStream::EndOfStream&) {}
         }, streams.size(), workersCount);
 
+        scheduler.buildAdjacency();
+        runAll([&](AppRequestIdType requestID) {
+            scheduler.finalizeRequest(requestID);
+        }, numOfRequests, workersCount);
+    }
+
+    /**
+     * Decodes the requests of a block without accessing the heap. The dependency graph of decoded requests can be
+     * verified by checkDependencyGraph() before the chunks of the block are indexed, but the requests can not be
+     * executed until bindRequests() is called.
+     * @param streams is a vector of request streams. (see loadRequests())
+     */
+    template<class RequestStream>
+    void decodeRequests(std::vector<RequestStream> streams) {
+        runAll([&](int i) {
+            try {
+                while (true) scheduler.deferRequest(streams.at(i).next());
+            } catch (const typename RequestStream::EndOfStream&) {}
+        }, streams.size(), workersCount);
+
+        scheduler.buildAdjacency();
+    }
+
+    /// binds the requests loaded by decodeRequests() to the heap. All pages of the block must be indexed before
+    /// calling this function.
+    void bindRequests() {
+        runAll([&](AppRequestIdType requestID) {
+            scheduler.bindRequest(requestID);
+        }, numOfRequests, workersCount);
+
         runAll([&](AppRequestIdType requestID) {
             scheduler.finalizeRequest(requestID);
         }, numOfRequests, workersCount);
@@ -76,7 +115,8 @@ public:
     std::vector<ascee::runtime::AppResponse> serialExecuteRequests() {
         std::vector<ascee::runtime::AppResponse> responseList;
         responseList.reserve(numOfRequests);
-        Executor executor;
+        responseSlab.reset();
+        Executor executor(responseSlab);
         for (int32_fast i = 0; i < numOfRequests; ++i) {
             responseList.emplace_back(executor.executeOne(scheduler.requestAt(i)));
         }
@@ -85,29 +125,125 @@ public:
 
     template<class Executor>
     std::vector<ascee::runtime::AppResponse> parallelExecuteRequests() {
-        scheduler.buildExecDag();
+        scheduler.buildExecDag(workersCount);
+        responseSlab.reset();
         // executor must be thread safe
-        Executor executor;
+        Executor executor(responseSlab);
 
         std::vector<ascee::runtime::AppResponse> responseList(numOfRequests);
-        std::vector<std::future<void>> pendingTasks;
-        pendingTasks.reserve(workersCount);
-        for (int i = 0; i < workersCount; ++i) {
-            pendingTasks.emplace_back(std::async([&] {
-                while (auto* request = scheduler.nextRequest()) {
-                    responseList[request->id] = executor.executeOne(request);
-                    scheduler.submitResult(request->id, responseList[request->id].statusCode);
+        // a worker can execute all requests alone, so it is fine if the pool runs fewer workers concurrently.
+        util::ThreadPool::global().parallelFor(workersCount, [&](int64_fast workerID) {
+            std::vector<ascee::runtime::AppRequest*> batch;
+            batch.reserve(max_batch_size);
+            while (scheduler.nextRequests(batch, max_batch_size, workerID)) {
+                auto start = std::chrono::steady_clock::now();
+                auto responses = executor.executeBatch(batch);
+                // the execution time of a batch is divided evenly between its requests.
+                auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count() / int64_t(batch.size());
+                for (int i = 0; i < batch.size(); ++i) {
+                    responseList[batch[i]->id] = std::move(responses[i]);
+                    appIndex.recordExecutionCost(batch[i]->calledAppID, cost);
                 }
-            }));
-        }
+                // after submitting the results, requests of the batch are not valid anymore.
+                scheduler.submitResults(batch, responseList, workerID);
+                batch.clear();
+            }
+        });
 
-        for (auto& pending: pendingTasks) {
-            pending.get();
-        }
+        return responseList;
+    }
+
+    /**
+     * Executes requests speculatively in parallel without using the dependency graph of the block. Requests are
+     * committed in the order of their identifiers. If a request has read a part of the heap which was modified by a
+     * request that was committed after the start of its execution, the request is executed again. Re-execution is
+     * done while the request owns the commit turn, so the second execution can never conflict.
+     *
+     * The final state of the heap is the same as the state produced by serialExecuteRequests().
+     *
+     * Other requests are committed while a request is being executed. Modifiers are put in speculative mode, so a
+     * request reads snapshots of its access blocks which are copied under the content mutex of their chunks, and
+     * commits hold the same mutex. Chunk sizes are atomic and committing a larger size never reallocates a chunk.
+     *
+     * Responses of executions are kept in a temporary slab, and only committed responses are copied into the slab of
+     * the processor, in the commit order.
+     */
+    template<class Executor>
+    std::vector<ascee::runtime::AppResponse> speculativeExecuteRequests() {
+        // this bit indicates that a worker has failed, and all workers must stop.
+        constexpr int32_fast aborted_bit = int32_fast(1) << 30;
+
+        // every request can be executed twice.
+        ascee::runtime::ResponseSlab executionSlab(2 * responseSlab.getCapacity());
+        responseSlab.reset();
+        Executor executor(executionSlab);
+        std::vector<ascee::runtime::AppResponse> responseList(numOfRequests);
+        std::atomic<int32_fast> nextID = 0;
+        // the number of committed requests
+        std::atomic<int32_fast> committed = 0;
+        CommitLog commitLog;
+        executionCount = 0;
+        abortCount = 0;
+
+        // requests are taken in order, so a worker never waits for a request which is not taken by a running worker.
+        util::ThreadPool::global().parallelFor(workersCount, [&](int64_fast) {
+            try {
+                for (int32_fast id = nextID++; id < numOfRequests; id = nextID++) {
+                    auto* request = scheduler.requestAt(id);
+                    auto snapshot = committed.load();
+                    request->modifier.setSpeculative(true);
+
+                    std::optional<ascee::runtime::AppResponse> response;
+                    try {
+                        response = executor.executeSpeculatively(request);
+                    } catch (const BlockError&) {
+                        // this could be the result of reading an inconsistent state of the heap.
+                    }
+                    ++executionCount;
+
+                    while (true) {
+                        auto c = committed.load();
+                        if (c & aborted_bit) return;
+                        if (c == id) break;
+                        committed.wait(c);
+                    }
+
+                    if (!response || commitLog.conflicts(request->modifier, snapshot)) {
+                        ++abortCount;
+                        ++executionCount;
+                        request->modifier.reset();
+                        request->failureManager.reset();
+                        request->signatureManager.reset();
+                        response = executor.executeSpeculatively(request);
+                    }
+
+                    if (response->statusCode > 400 && !request->attachments.empty()) {
+                        throw BlockError("block contains a failed fee payment");
+                    }
+                    commitLog.record(request->modifier, id);
+                    request->modifier.writeToHeap();
+                    responseList[id] = {response->statusCode, responseSlab.store(response->httpResponse)};
+
+                    committed.fetch_add(1);
+                    committed.notify_all();
+                }
+            } catch (...) {
+                committed.fetch_or(aborted_bit);
+                committed.notify_all();
+                throw;
+            }
+        });
 
         return responseList;
     }
 
+    /// the ratio of speculative executions that were discarded in the last call of speculativeExecuteRequests()
+    [[nodiscard]]
+    double getAbortRate() const {
+        return executionCount == 0 ? 0 : double(abortCount) / double(executionCount);
+    }
+
     /**
      *
      * @param task is a function that accepts a taskID and runs the corresponding task with that id.
@@ -116,28 +252,56 @@ public:
      */
     static
     void runAll(const std::function<void(int64_fast)>& task, int64_fast tasksCount, int workersCount) {
-        const auto step = std::max<int64_fast>(tasksCount / workersCount, 1);
-
-        std::vector<std::future<void>> pendingTasks;
-        pendingTasks.reserve(workersCount);
-        for (int i = 0; i <= workersCount; ++i) {
-            pendingTasks.emplace_back(std::async([&, i] {
-                for (int64_fast taskID = i * step; taskID < (i + 1) * step && taskID < tasksCount; ++taskID) {
-                    task(taskID);
+        // exceptions thrown by tasks will be rethrown here.
+        util::ThreadPool::global().parallelFor(tasksCount, task, (tasksCount + workersCount - 1) / workersCount);
+    }
+
+private:
+    /// Keeps the heap ranges modified by committed requests. It must only be accessed by the owner of the commit turn.
+    class CommitLog {
+    public:
+        bool conflicts(ascee::runtime::HeapModifier& modifier, AppRequestIdType since) {
+            bool found = false;
+            modifier.forEachHeapRead([&](const ascee::runtime::Chunk* chunk, uint32 begin, uint32 end) {
+                if (found) return;
+                auto it = writes.find(chunk);
+                if (it == writes.end()) return;
+                // ranges are recorded in the commit order, so we only need to check the tail of the list.
+                for (auto r = it->second.rbegin(); r != it->second.rend() && r->writer >= since; ++r) {
+                    if (r->begin < end && begin < r->end) {
+                        found = true;
+                        return;
+                    }
                 }
-            }));
+            });
+            return found;
         }
 
-        for (auto& pending: pendingTasks) {
-            // by using get() instead of wait() exceptions will be rethrown here.
-            pending.get();
+        void record(ascee::runtime::HeapModifier& modifier, AppRequestIdType writer) {
+            modifier.forEachHeapWrite([&](const ascee::runtime::Chunk* chunk, uint32 begin, uint32 end) {
+                writes[chunk].emplace_back(WrittenRange{begin, end, writer});
+            });
         }
-    }
 
-private:
+    private:
+        struct WrittenRange {
+            uint32 begin;
+            uint32 end;
+            AppRequestIdType writer;
+        };
+
+        std::unordered_map<const ascee::runtime::Chunk*, std::vector<WrittenRange>> writes;
+    };
+
     RequestScheduler scheduler;
+    asa::AppIndex& appIndex;
     const int32_fast numOfRequests;
     int workersCount;
+    /// responses returned by the execute functions point to this slab. The slab is reused by every execution of the
+    /// block, hence responses are only valid until the next call of an execute function.
+    ascee::runtime::ResponseSlab responseSlab;
+    std::atomic<int32_fast> executionCount = 0;
+    std::atomic<int32_fast> abortCount = 0;
 };
 
 } // namespace argennon::ave
@@ -16,6 +16,7 @@
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include "RequestScheduler.h"
+#include <algorithm>
 
 
 using namespace argennon;
@@ -24,17 +25,110 @@ using namespace ascee::runtime;
 using namespace util;
 using std::make_unique, std::vector, asa::ChunkIndex;
 
-AppRequest* RequestScheduler::nextRequest() {
-    try {
-        auto* result = &zeroQueue.blockingDequeue(true)->getAppRequest();
-        return result;
-    } catch (const std::underflow_error&) {
-        if (remaining != 0) throw BlockError("execution graph is not a dag");
-        return nullptr;
+AppRequest* RequestScheduler::nextRequest(int workerID) {
+    auto* node = findReadyNode(workerID);
+    return node == nullptr ? nullptr : &node->getAppRequest();
+}
+
+bool RequestScheduler::nextRequests(vector<AppRequest*>& batch, int maxCount, int workerID) {
+    auto* node = findReadyNode(workerID);
+    if (node == nullptr) return false;
+    batch.emplace_back(&node->getAppRequest());
+    // the rest of the batch is only taken from the worker's own queue, so idle workers can still take requests.
+    auto& own = *readyQueues[workerID];
+    while (batch.size() < maxCount && own.topPriority.load(std::memory_order_relaxed) != ReadyQueue::empty &&
+           own.topPriority.load(std::memory_order_relaxed) >= othersTopPriority(workerID)) {
+        if ((node = own.pop()) == nullptr) break;
+        batch.emplace_back(&node->getAppRequest());
+    }
+    return true;
+}
+
+DagNode* RequestScheduler::findReadyNode(int workerID) {
+    auto workersCount = int(readyQueues.size());
+    assert(workerID < workersCount);
+    while (true) {
+        // the epoch is read before the queues, so a request that becomes ready after the scan changes the epoch.
+        auto epoch = readyEpoch.load();
+        // the worker's own queue is preferred when priorities are equal, which helps data locality.
+        int best = workerID;
+        auto bestPriority = readyQueues[workerID]->topPriority.load(std::memory_order_relaxed);
+        for (int i = 1; i < workersCount; ++i) {
+            auto q = (workerID + i) % workersCount;
+            auto priority = readyQueues[q]->topPriority.load(std::memory_order_relaxed);
+            if (priority > bestPriority) best = q, bestPriority = priority;
+        }
+        if (bestPriority != ReadyQueue::empty) {
+            // another worker could have taken the node, then we just try again.
+            if (auto* node = readyQueues[best]->pop()) return node;
+            continue;
+        }
+        if (remaining == 0) return nullptr;
+        // when no request is ready or running, no request will become ready anymore.
+        if (pending == 0) throw BlockError("execution graph is not a dag");
+        ++idleWorkers;
+        readyEpoch.wait(epoch);
+        --idleWorkers;
+    }
+}
+
+void RequestScheduler::wakeIdleWorkers() {
+    readyEpoch.fetch_add(1);
+    // an idle worker increments idleWorkers before waiting, so it either is notified here or sees the new epoch.
+    if (idleWorkers.load() > 0) readyEpoch.notify_all();
+}
+
+int64_t RequestScheduler::othersTopPriority(int workerID) const {
+    auto result = ReadyQueue::empty;
+    for (int i = 0; i < readyQueues.size(); ++i) {
+        if (i != workerID) result = std::max(result, readyQueues[i]->topPriority.load(std::memory_order_relaxed));
+    }
+    return result;
+}
+
+/// nodes with equal priorities are ordered by their ids, so a single worker always executes the graph in the same
+/// order.
+static bool lowerPriority(DagNode* a, DagNode* b) {
+    if (a->getPriority() != b->getPriority()) return a->getPriority() < b->getPriority();
+    return a->getAppRequest().id > b->getAppRequest().id;
+}
+
+void RequestScheduler::ReadyQueue::push(std::span<DagNode* const> nodes) {
+    if (nodes.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto* node: nodes) {
+        heap.emplace_back(node);
+        std::push_heap(heap.begin(), heap.end(), lowerPriority);
+    }
+    topPriority.store(heap.front()->getPriority(), std::memory_order_relaxed);
+}
+
+DagNode* RequestScheduler::ReadyQueue::pop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (heap.empty()) return nullptr;
+    std::pop_heap(heap.begin(), heap.end(), lowerPriority);
+    auto* node = heap.back();
+    heap.pop_back();
+    topPriority.store(heap.empty() ? empty : heap.front()->getPriority(), std::memory_order_relaxed);
+    return node;
+}
+
+void RequestScheduler::submitResult(AppRequestIdType reqID, int statusCode, int workerID) {
+    releaseSuccessors(reqID, statusCode, workerID);
+    if (--pending == 0) wakeIdleWorkers();
+}
+
+void RequestScheduler::submitResults(const vector<AppRequest*>& batch, const vector<AppResponse>& responses,
+                                     int workerID) {
+    for (auto* request: batch) {
+        auto id = request->id;
+        releaseSuccessors(id, responses[id].statusCode, workerID);
     }
+    // successors are counted before the batch is removed, so pending never becomes zero while there is work to do.
+    if ((pending -= int_fast32_t(batch.size())) == 0) wakeIdleWorkers();
 }
 
-void RequestScheduler::submitResult(AppRequestIdType reqID, int statusCode) {
+void RequestScheduler::releaseSuccessors(AppRequestIdType reqID, int statusCode, int workerID) {
     // This function is thread-safe
     auto& reqNode = nodeIndex[reqID];
 
@@ -42,16 +136,20 @@ void RequestScheduler::submitResult(AppRequestIdType reqID, int statusCode) {
         throw BlockError("block contains a failed fee payment");
     }
 
-    for (const auto id: reqNode->adjacentNodes()) {
+    static thread_local vector<DagNode*> ready;
+    ready.clear();
+    for (const auto id: successorsOf(reqID)) {
         // We assume that adj list of all nodes are checked before, and always we have adjID < nodeIndex.size()
         auto& adjNode = nodeIndex[id];
-        if (adjNode->decrementInDegree() == 0) {
-            zeroQueue.enqueue(adjNode.get());
-        }
+        if (adjNode->decrementInDegree() == 0) ready.emplace_back(adjNode.get());
+    }
+    if (!ready.empty()) {
+        pending += int_fast32_t(ready.size());
+        readyQueues[workerID]->push(ready);
+        wakeIdleWorkers();
     }
     reqNode.reset();
-    --remaining;
-    zeroQueue.removeProducer();
+    if (--remaining == 0) wakeIdleWorkers();
 }
 
 /// sortedOffsets needs to be a sorted list of offsets, and AccessBlocks are corresponding BlockAccessInfos with
@@ -116,9 +214,24 @@ void RequestScheduler::findCollisions(
 void RequestScheduler::addRequest(AppRequestInfo&& data) {
     auto id = data.id;
     memoryAccessMaps[id] = std::move(data.memoryAccessMap);
+    addedAdjLists[id] = std::move(data.adjList);
     nodeIndex[id] = std::make_unique<DagNode>(std::move(data), this);
 }
 
+void RequestScheduler::deferRequest(AppRequestInfo&& data) {
+    std::call_once(deferredAllocated, [this] {
+        deferredRequests = std::make_unique<AppRequestInfo[]>(remaining.load());
+    });
+    auto id = data.id;
+    memoryAccessMaps[id] = std::move(data.memoryAccessMap);
+    addedAdjLists[id] = std::move(data.adjList);
+    deferredRequests[id] = std::move(data);
+}
+
+void RequestScheduler::bindRequest(AppRequestIdType id) {
+    nodeIndex[id] = std::make_unique<DagNode>(std::move(deferredRequests[id]), this);
+}
+
 AppRequest* RequestScheduler::requestAt(AppRequestIdType id) {
     return &nodeIndex[id]->getAppRequest();
 }
@@ -128,27 +241,99 @@ RequestScheduler::RequestScheduler(int32_fast totalRequestCount, ChunkIndex& hea
         appIndex(appIndex),
         remaining(totalRequestCount),
         nodeIndex(std::make_unique<std::unique_ptr<DagNode>[]>(totalRequestCount)),
-        memoryAccessMaps(totalRequestCount) {}
+        memoryAccessMaps(totalRequestCount),
+        addedAdjLists(std::make_unique<std::vector<AppRequestIdType>[]>(totalRequestCount)) {}
+
+void RequestScheduler::buildAdjacency() {
+    assert(addedAdjLists);
+    auto n = remaining.load();
+    std::size_t edgeCount = 0;
+    for (int i = 0; i < n; ++i) {
+        auto& adjList = addedAdjLists[i];
+        std::sort(adjList.begin(), adjList.end());
+        adjList.erase(std::unique(adjList.begin(), adjList.end()), adjList.end());
+        edgeCount += adjList.size();
+    }
+    adjOffsets.reserve(n + 1);
+    adjacency.reserve(edgeCount);
+    for (int i = 0; i < n; ++i) {
+        adjOffsets.emplace_back(adjacency.size());
+        adjacency.insert(adjacency.end(), addedAdjLists[i].begin(), addedAdjLists[i].end());
+    }
+    adjOffsets.emplace_back(adjacency.size());
+    addedAdjLists.reset();
+}
 
-void RequestScheduler::buildExecDag() {
+std::span<const AppRequestIdType> RequestScheduler::successorsOf(AppRequestIdType id) const {
+    assert(id + 1 < adjOffsets.size());
+    return {adjacency.data() + adjOffsets[id], adjacency.data() + adjOffsets[id + 1]};
+}
+
+bool RequestScheduler::hasEdge(AppRequestIdType u, AppRequestIdType v) const {
+    auto successors = successorsOf(u);
+    return std::binary_search(successors.begin(), successors.end(), v);
+}
+
+void RequestScheduler::buildExecDag(int workersCount) {
+    calculatePriorities();
+    readyQueues.clear();
+    for (int i = 0; i < workersCount; ++i) {
+        readyQueues.emplace_back(std::make_unique<ReadyQueue>());
+    }
+    vector<DagNode*> sources;
     for (int i = 0; i < remaining; ++i) {
         if (nodeIndex[i]->getInDegree() == 0) {
-            zeroQueue.enqueue(nodeIndex[i].get());
+            sources.emplace_back(nodeIndex[i].get());
         } else {
             break;
         }
     }
-    if (zeroQueue.isEmpty()) throw BlockError("source node of the execution DAG is missing");
+    if (sources.empty()) throw BlockError("source node of the execution DAG is missing");
+    std::stable_sort(sources.begin(), sources.end(), [](const DagNode* a, const DagNode* b) {
+        return a->getPriority() > b->getPriority();
+    });
+    // source nodes are distributed between workers, and they are pushed before workers are started.
+    for (int i = 0; i < sources.size(); ++i) readyQueues[i % workersCount]->push({&sources[i], 1});
+    pending = int_fast32_t(sources.size());
+}
+
+void RequestScheduler::calculatePriorities() {
+    // nodes are sorted topologically using Kahn's algorithm, then priorities are calculated in the reverse order.
+    // Nodes of a loop are not sorted and their priority will only be their own cost. Loops are detected later, during
+    // the execution.
+    auto n = remaining.load();
+    vector<int_fast32_t> inDegrees(n);
+    vector<AppRequestIdType> sorted;
+    sorted.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        inDegrees[i] = nodeIndex[i]->getInDegree();
+        if (inDegrees[i] == 0) sorted.emplace_back(i);
+    }
+    for (int32_fast i = 0; i < sorted.size(); ++i) {
+        for (const auto id: successorsOf(sorted[i])) {
+            if (--inDegrees[id] == 0) sorted.emplace_back(id);
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        nodeIndex[i]->setPriority(appIndex.getExecutionCost(nodeIndex[i]->getAppRequest().calledAppID));
+    }
+    for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
+        auto& node = nodeIndex[*it];
+        int64_t longest = 0;
+        for (const auto id: successorsOf(*it)) longest = std::max(longest, nodeIndex[id]->getPriority());
+        node->setPriority(node->getPriority() + longest);
+    }
 }
 
 AppRequestInfo::AccessMapType RequestScheduler::sortAccessBlocks(int workersCount) {
+    // mergeAllParallel() copies the maps, so memoryAccessMaps can still be used for binding deferred requests.
     return util::mergeAllParallel(std::move(memoryAccessMaps), workersCount);
 }
 
 void RequestScheduler::finalizeRequest(AppRequestIdType id) {
     printf(" finalized: %ld ", id);
     auto& node = nodeIndex[id];
-    for (const auto adjID: node->adjacentNodes()) {
+    for (const auto adjID: successorsOf(id)) {
         nodeIndex[adjID]->incrementInDegree();
     }
 
@@ -160,7 +345,7 @@ void RequestScheduler::finalizeRequest(AppRequestIdType id) {
 
 void RequestScheduler::registerDependency(AppRequestIdType u, AppRequestIdType v) {
     assert(u != v);
-    if (!nodeIndex[u]->isAdjacent(v) && !nodeIndex[v]->isAdjacent(u)) {
+    if (!hasEdge(u, v) && !hasEdge(v, u)) {
         throw BlockError("missing {" + std::to_string(u) + "," + std::to_string(v) +
                          "} edge in the dependency graph");
     }
@@ -181,7 +366,7 @@ bool RequestScheduler::canMerge(const AccessBlockInfo& left, int32 leftOffset,
 RequestScheduler::operator std::string() const {
     std::string result;
     for (int i = 0; i < remaining; ++i) {
-        result += std::to_string(nodeIndex[i]->adjacentNodes().size()) + "=";
+        result += std::to_string(successorsOf(i).size()) + "=";
     }
     return result;
 }
@@ -228,6 +413,9 @@ DagNode::DagNode(AppRequestInfo&& data,
                 .modifier = scheduler->getModifierFor(data.id),
                 .appTable = scheduler->getAppTableFor(std::move(data.appAccessList)),
                 .useControlledExecution = data.useControlledExecution,
+                // requests that declare no failures are expected to succeed, so they are first executed inline.
+                .optimisticFirst = data.useControlledExecution &&
+                                   data.stackSizeFailures.empty() && data.cpuTimeFailures.empty(),
                 .failureManager = FailureManager(
                         std::move(data.stackSizeFailures),
                         std::move(data.cpuTimeFailures)
@@ -236,5 +424,4 @@ DagNode::DagNode(AppRequestInfo&& data,
                 .signatureManager = scheduler->getSigManagerFor(std::move(data.signedMessagesList)),
                 .digest = std::move(data.digest)
                 // Members are initialized in left-to-right order as they appear in this class's base-specifier list.
-        },
-        adjList(std::move(data.adjList)) {}
+        } {}
@@ -18,13 +18,14 @@
 #ifndef ARGENNON_EXEC_SCHEDULER_H
 #define ARGENNON_EXEC_SCHEDULER_H
 
-#include <unordered_set>
 #include <atomic>
 #include <cassert>
+#include <mutex>
+#include <span>
+#include <vector>
 
 #include "core/primitives.h"
 #include "core/info.h"
-#include "util/BlockingQueue.hpp"
 #include "storage/ChunkIndex.h"
 #include "ascee/executor/Executor.h"
 #include "storage/AppIndex.h"
@@ -51,20 +52,19 @@ public:
         return inDegree;
     }
 
-    auto& adjacentNodes() {
-        return adjList;
-    }
+    /// the estimated execution time of the longest path which starts from this node. Nodes with a higher priority
+    /// are executed first.
+    [[nodiscard]]
+    int64_t getPriority() const { return priority; }
 
-    bool isAdjacent(AppRequestIdType other) const {
-        return adjList.contains(other);
-    }
+    void setPriority(int64_t p) { priority = p; }
 
     explicit DagNode(AppRequestInfo&& data, const RequestScheduler* scheduler);
 
 private:
     ascee::runtime::AppRequest request;
-    const std::unordered_set<AppRequestIdType> adjList;
     std::atomic<int_fast32_t> inDegree = 0;
+    int64_t priority = 0;
 };
 
 template<class Dag>
@@ -153,9 +153,35 @@ private:
 /// RequestSchedulers are created per block
 class RequestScheduler {
 public:
-    ascee::runtime::AppRequest* nextRequest();
+    /**
+     * Waits for a ready request. Every worker has its own priority queue of ready requests, and a worker takes the
+     * request with the highest priority among the top requests of all queues. This way, requests are executed in
+     * the order of their priorities, while most of the time workers only access their own queue.
+     * @param workerID must be less than the workersCount given to buildExecDag(). Different threads must use
+     * different ids.
+     * @return nullptr when there are no more requests to execute.
+     */
+    ascee::runtime::AppRequest* nextRequest(int workerID = 0);
+
+    /// the successors of the request are added to the ready queue of the worker, which helps data locality.
+    void submitResult(AppRequestIdType reqID, int statusCode, int workerID = 0);
+
+    /**
+     * Waits for ready requests and puts at most @p maxCount of them in @p batch. Only the first request may be taken
+     * from the queues of other workers. The rest of the batch is taken from the worker's own queue, as long as its
+     * top request has the highest priority.
+     * @param batch must be empty.
+     * @return false when there are no more requests to execute.
+     */
+    bool nextRequests(std::vector<ascee::runtime::AppRequest*>& batch, int maxCount, int workerID);
 
-    void submitResult(AppRequestIdType reqID, int statusCode);
+    /**
+     * Releases the successors of a batch of requests. After calling this function the requests of the batch will be
+     * destroyed.
+     * @param responses is the list of responses indexed by request id.
+     */
+    void submitResults(const std::vector<ascee::runtime::AppRequest*>& batch,
+                       const std::vector<ascee::runtime::AppResponse>& responses, int workerID);
 
     void findCollisions(full_id chunkID,
                         const std::vector<int32>& sortedOffsets,
@@ -167,10 +193,35 @@ public:
     /// this function is thread-safe as long as all used `id`s are distinct
     void addRequest(AppRequestInfo&& data);
 
+    /**
+     * Adds a request without binding it to the heap. The dependency graph of deferred requests can be verified before
+     * the chunks accessed by them are indexed, but bindRequest() must be called for every deferred request before
+     * finalizeRequest() is called.
+     * @note this function is thread-safe as long as all used `id`s are distinct
+     */
+    void deferRequest(AppRequestInfo&& data);
+
+    /// creates the heap modifier and the execution context of a deferred request. This function is thread-safe as
+    /// long as all used `id`s are distinct
+    void bindRequest(AppRequestIdType id);
+
+    /**
+     * Builds the adjacency lists of the execution DAG. This function must be called once, after all requests are
+     * added, and before any other function is called.
+     */
+    void buildAdjacency();
+
     /// this function should be called after all requests are added. (using addRequest() or requestAt())
     void finalizeRequest(AppRequestIdType id);
 
-    void buildExecDag();
+    /**
+     * Calculates the priorities of requests and creates the ready queues of workers. The priority of a request is the
+     * estimated execution time of the longest path starting from the request in the execution DAG, which is
+     * calculated using the execution costs recorded in the AppIndex.
+     *
+     * Calls to nextRequest() must use a workerID less than @p workersCount.
+     */
+    void buildExecDag(int workersCount = 1);
 
     [[nodiscard]]
     AppRequestInfo::AccessMapType sortAccessBlocks(int workersCount);
@@ -292,20 +343,67 @@ public:
     [[nodiscard]]
     bool isAdjacent(AppRequestIdType u, AppRequestIdType v) const {
         printf("e:(%ld,%ld)\n", u, v);
-        return nodeIndex[u]->isAdjacent(v);
+        return hasEdge(u, v);
     }
 
 
 private:
     asa::ChunkIndex& heapIndex;
     asa::AppIndex& appIndex;
+    /// the number of requests that are not executed yet. Execution ends when it becomes zero.
     std::atomic<int_fast32_t> remaining;
-    util::BlockingQueue<DagNode*> zeroQueue;
+    /// the number of requests that are ready or are being executed. When it becomes zero while some requests remain,
+    /// the execution graph has a cycle.
+    std::atomic<int_fast32_t> pending = 0;
+    /// incremented whenever requests become ready or execution ends. Idle workers wait for it to change.
+    std::atomic<uint32_t> readyEpoch = 0;
+    std::atomic<int> idleWorkers = 0;
+    /// a priority queue of ready nodes, which is owned by a worker. The priority of its top node is published in
+    /// `topPriority`, so workers can find the queue with the highest priority without locking all queues.
+    struct alignas(64) ReadyQueue {
+        static constexpr int64_t empty = INT64_MIN;
+
+        std::mutex mutex;
+        std::vector<DagNode*> heap;
+        std::atomic<int64_t> topPriority = empty;
+
+        void push(std::span<DagNode* const> nodes);
+
+        /// returns nullptr when the queue is empty.
+        DagNode* pop();
+    };
+
+    std::vector<std::unique_ptr<ReadyQueue>> readyQueues;
     std::unique_ptr<std::unique_ptr<DagNode>[]> nodeIndex;
     std::vector<AppRequestInfo::AccessMapType> memoryAccessMaps;
+    /// requests added by deferRequest(), which are kept until they are bound to the heap.
+    std::once_flag deferredAllocated;
+    std::unique_ptr<AppRequestInfo[]> deferredRequests;
+    /// adjacency lists of requests, which are kept until buildAdjacency() is called.
+    std::unique_ptr<std::vector<AppRequestIdType>[]> addedAdjLists;
+    // The adjacency lists of all requests are stored in a compressed sparse row format: the sorted successors of
+    // request i are adjacency[adjOffsets[i]...adjOffsets[i + 1]).
+    std::vector<std::size_t> adjOffsets;
+    std::vector<AppRequestIdType> adjacency;
 
     void registerDependency(AppRequestIdType u, AppRequestIdType v);
 
+    std::span<const AppRequestIdType> successorsOf(AppRequestIdType id) const;
+
+    [[nodiscard]]
+    bool hasEdge(AppRequestIdType u, AppRequestIdType v) const;
+
+    void releaseSuccessors(AppRequestIdType reqID, int statusCode, int workerID);
+
+    DagNode* findReadyNode(int workerID);
+
+    void wakeIdleWorkers();
+
+    /// returns the highest priority among the top nodes of the queues of other workers.
+    int64_t othersTopPriority(int workerID) const;
+
+    void calculatePriorities();
+
     void injectDigest(Digest digest, std::string& httpRequest) {}
 
     static bool
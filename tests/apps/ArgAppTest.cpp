@@ -116,13 +116,15 @@ TEST_F(ArgAppTest, SimpleTransfer) {
     RequestScheduler scheduler(1, index, appIndex);
 
     scheduler.addRequest(std::move(transferReq));
+    scheduler.buildAdjacency();
     scheduler.finalizeRequest(0);
     scheduler.buildExecDag();
 
     Executor executor;
     auto response = executor.executeOne(scheduler.nextRequest());
 
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n", response.httpResponse.c_str());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response.httpResponse.size()), response.httpResponse.data());
 
     EXPECT_EQ(response.statusCode, 200);
     EXPECT_EQ((std::string) *page_1.getNative(),
@@ -158,19 +160,62 @@ TEST_F(ArgAppTest, SimpleCreateAcc) {
     RequestScheduler scheduler(1, index, appIndex);
 
     scheduler.addRequest(std::move(createReq));
+    scheduler.buildAdjacency();
     scheduler.finalizeRequest(0);
     scheduler.buildExecDag();
 
     Executor executor;
     auto response = executor.executeOne(scheduler.nextRequest());
 
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n", response.httpResponse.c_str());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response.httpResponse.size()), response.httpResponse.data());
 
     EXPECT_EQ(response.statusCode, 200);
     EXPECT_EQ((std::string) *p.getNative(),
               "size: 67, capacity: 67, content: 0x[ 8 0 a7 3f e3 af ce 2b e7 27 3e 56 2b 91 fb f0 e3 b2 dd 82 ea 29 11 43 79 77 4d 0 5f 99 26 82 d8 ef 50 59 55 0 97 77 0 80 22 6d 23 61 d5 a4 5a 20 eb a6 de cd 17 d5 75 cb 28 e0 7 80 f3 6c 25 46 0 ]");
 }
 
+TEST_F(ArgAppTest, FailedRootCallRollback) {
+    // the forwarded gas is too low for calling the app, so the optimistic attempt fails and its root call is rolled
+    // back, then the request is executed again using controlled calls.
+    AppRequestInfo createReq{
+            .id = 0,
+            .calledAppID = arg_app_id_g,
+            .httpRequest = "PUT /balances/0x9777 HTTP/1.1\r\n"
+                           "Content-Type: application/json; charset=utf-8\r\n"
+                           "Content-Length: 2\r\n"
+                           "\r\n"
+                           "{}",
+            .maxClocks = 1,
+            .appAccessList = {arg_app_id_g},
+            .useControlledExecution = true,
+            .memoryAccessMap = {
+                    {arg_app_id_g},
+                    {{{{0x9777000000000000, 0}},
+                             {
+                                     {{-1, 0}, {{67, Access::writable, 0}, {67, Access::writable, 0}}},
+                             }}}}
+    };
+
+    Page p(46);
+    auto newChunkID = full_id(arg_app_id_g, {0x9777000000000000, 0});
+    ChunkIndex index({}, {{newChunkID, &p}}, {{newChunkID},
+                                              {{67, 0}}}, 4);
+
+    RequestScheduler scheduler(1, index, appIndex);
+
+    scheduler.addRequest(std::move(createReq));
+    scheduler.buildAdjacency();
+    scheduler.finalizeRequest(0);
+    scheduler.buildExecDag();
+
+    Executor executor;
+    auto response = executor.executeOne(scheduler.nextRequest());
+
+    EXPECT_EQ(response.statusCode, int(ascee::StatusCode::invalid_operation));
+    EXPECT_EQ((std::string) *p.getNative(), "size: 0, capacity: 67, content: 0x[ ]");
+}
+
 class FakeStream {
 public:
     class EndOfStream : std::exception {
@@ -319,8 +364,10 @@ TEST_F(ArgAppTest, TwoTransfers) {
 #endif
 
 
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n", response[0].httpResponse.c_str());
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n", response[1].httpResponse.c_str());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response[0].httpResponse.size()), response[0].httpResponse.data());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response[1].httpResponse.size()), response[1].httpResponse.data());
 
     EXPECT_EQ(response[0].statusCode, 200);
     EXPECT_EQ(response[1].statusCode, 200);
@@ -552,10 +599,14 @@ TEST_F(ArgAppTest, FourTransfers) {
 #endif
 
 
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n", response[0].httpResponse.c_str());
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n", response[1].httpResponse.c_str());
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n", response[2].httpResponse.c_str());
-    printf("<<<******* Response *******>>> \n%s\n<<<************************>>>\n", response[3].httpResponse.c_str());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response[0].httpResponse.size()), response[0].httpResponse.data());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response[1].httpResponse.size()), response[1].httpResponse.data());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response[2].httpResponse.size()), response[2].httpResponse.data());
+    printf("<<<******* Response *******>>> \n%.*s\n<<<************************>>>\n",
+           int(response[3].httpResponse.size()), response[3].httpResponse.data());
 
     EXPECT_EQ(response[0].statusCode, 200);
     EXPECT_EQ(response[1].statusCode, 200);
@@ -42,6 +42,7 @@ struct AppTestCase {
     int_fast32_t gas;
     vector<long_id> appAccessList;
     bool useControlled = true;
+    bool optimisticFirst = false;
     string wantResponse;
     int wantCode;
     vector<std::pair<std::string_view, uint64_t>> wantCalls;
@@ -64,6 +65,7 @@ struct AppTestCase {
                 .modifier = argennon::mocking::ascee::MockModifier(),
                 .appTable = appIndex.buildAppTable(shiftedAccessList),
                 .useControlledExecution = useControlled,
+                .optimisticFirst = optimisticFirst,
                 .signatureManager = VirtualSignatureManager({})
         };
         {
@@ -167,6 +169,7 @@ TEST_F(AsceeExecutorTest, ZeroGasTwoLevelCall) {
             .wantCode = 200,
             .wantCalls = {
                     {"save", 0},
+                    {"save", 1},
                     {"load", 15},
                     {"load", 0},
             }
@@ -189,9 +192,10 @@ TEST_F(AsceeExecutorTest, AppNotFound) {
             .wantCode = 200,
             .wantCalls = {
                     {"save",    0},
-                    {"load",    16},
                     {"save",    1},
-                    {"restore", 1},
+                    {"load",    16},
+                    {"save",    2},
+                    {"restore", 2},
                     {"load",    16},
                     {"load",    0},
             }
@@ -214,9 +218,10 @@ TEST_F(AsceeExecutorTest, AppNotDeclared) {
             .wantCode = 200,
             .wantCalls = {
                     {"save",    0},
-                    {"load",    15},
                     {"save",    1},
-                    {"restore", 1},
+                    {"load",    15},
+                    {"save",    2},
+                    {"restore", 2},
                     {"load",    15},
                     {"load",    0},
             }
@@ -240,9 +245,10 @@ TEST_F(AsceeExecutorTest, SimpleTimeOut) {
             .wantCode = 421,
             .wantCalls = {
                     {"save",    0},
+                    {"save",    1},
                     {"load",    10},
                     {"load",    0},
-                    {"restore", 0},
+                    {"restore", 1},
                     {"*load",   0},
             }
     };
@@ -264,11 +270,12 @@ TEST_F(AsceeExecutorTest, CalledTimeOut) {
             .wantCode = 200,
             .wantCalls = {
                     {"save",    0},
-                    {"load",    12},
                     {"save",    1},
+                    {"load",    12},
+                    {"save",    2},
                     {"load",    10},
                     {"load",    12},
-                    {"restore", 1},
+                    {"restore", 2},
                     {"*load",   12},
                     {"load",    0},
             }
@@ -291,9 +298,10 @@ TEST_F(AsceeExecutorTest, SimpleStackOverflow) {
             .wantCode = (int) StatusCode::memory_fault,
             .wantCalls = {
                     {"save",    0},
+                    {"save",    1},
                     {"load",    13},
                     {"load",    0},
-                    {"restore", 0},
+                    {"restore", 1},
                     {"*load",   0},
             }
     };
@@ -315,11 +323,12 @@ TEST_F(AsceeExecutorTest, CalledStackOverflow) {
             .wantCode = 200,
             .wantCalls = {
                     {"save",    0},
-                    {"load",    14},
                     {"save",    1},
+                    {"load",    14},
+                    {"save",    2},
                     {"load",    13},
                     {"load",    14},
-                    {"restore", 1},
+                    {"restore", 2},
                     {"*load",   14},
                     {"load",    0},
             }
@@ -327,6 +336,79 @@ TEST_F(AsceeExecutorTest, CalledStackOverflow) {
     SUB_TEST("stack overflow", testCase);
 }
 
+TEST_F(AsceeExecutorTest, OptimisticFirst) {
+    StringBuffer<1024> buf;
+    AppTestCase testCase{
+            .libPath = "testdata/single-thread/call",
+            .calledApp = 15,
+            .request = "test request",
+            .gas = NORMAL_GAS,
+            .appAccessList = {11, 15},
+            .optimisticFirst = true,
+            .wantResponse = "request from 15 is DONE! got in 15",
+            .wantCode = 200,
+    };
+    SUB_TEST("inline", testCase);
+
+    // errors of callees are returned to the caller without executing the request again.
+    testCase = {
+            .libPath = "testdata/single-thread/call",
+            .calledApp = 15,
+            .request = "test request",
+            .gas = NORMAL_GAS,
+            .appAccessList = {15},
+            .optimisticFirst = true,
+            .wantResponse = string(Executor::Error(
+                    "app/0xb00000000000000 was not declared in the call list",
+                    StatusCode::limit_violated,
+                    toLongID(15)).toHttpResponse(buf)) + " got in 15",
+            .wantCode = 200,
+            .wantCalls = {
+                    {"save",    0},
+                    {"save",    1},
+                    {"load",    15},
+                    {"save",    2},
+                    {"restore", 2},
+                    {"load",    15},
+                    {"load",    0},
+            }
+    };
+    SUB_TEST("inline callee error", testCase);
+
+    buf.clear();
+    // a failed call makes the request to be executed again by the controlled caller.
+    testCase = {
+            .libPath = "testdata/single-thread/stack-overflow",
+            .calledApp = 14,
+            .request = "test request",
+            .gas = NORMAL_GAS,
+            .appAccessList = {13, 14},
+            .optimisticFirst = true,
+            .wantResponse = string(Executor::Error(
+                    "segmentation fault (possibly stack overflow)",
+                    StatusCode::memory_fault,
+                    toLongID(13)).toHttpResponse(buf)) + " OVER FLOW... fib: 832040",
+            .wantCode = 200,
+    };
+    SUB_TEST("stack overflow fallback", testCase);
+
+    buf.clear();
+    testCase = {
+            .libPath = "testdata/single-thread/timeout",
+            .calledApp = 12,
+            .request = "test request",
+            .gas = NORMAL_GAS,
+            .appAccessList = {10, 12},
+            .optimisticFirst = true,
+            .wantResponse = string(Executor::Error(
+                    "cpu timer expired",
+                    StatusCode::execution_timeout,
+                    toLongID(10)).toHttpResponse(buf)) + " TOO LONG...",
+            .wantCode = 200,
+    };
+    SUB_TEST("time out fallback", testCase);
+}
+
 TEST_F(AsceeExecutorTest, CircularCallLowGas) {
     StringBuffer<1024> buf;
     AppTestCase testCase{
@@ -398,38 +480,39 @@ TEST_F(AsceeExecutorTest, FailedCalls) {
             .wantCode = 200,
             .wantCalls = {
                     {"save",    0},
+                    {"save",    1},
                     {"load",    19},
 
-                    {"save",    1},
+                    {"save",    2},
                     {"load",    10},
                     {"load",    19},
-                    {"restore", 1},
+                    {"restore", 2},
                     {"*load",   19},
 
-                    {"save",    1},
+                    {"save",    2},
                     {"load",    20},
                     {"load",    19},
-                    {"restore", 1},
+                    {"restore", 2},
                     {"*load",   19},
 
-                    {"save",    1},
-                    {"restore", 1},
+                    {"save",    2},
+                    {"restore", 2},
                     {"*load",   19},
 
-                    {"save",    1},
-                    {"restore", 1},
+                    {"save",    2},
+                    {"restore", 2},
                     {"*load",   19},
 
-                    {"save",    1},
+                    {"save",    2},
                     {"load",    21},
                     {"load",    19},
-                    {"restore", 1},
+                    {"restore", 2},
                     {"*load",   19},
 
-                    {"save",    1},
+                    {"save",    2},
                     {"load",    24},
                     {"load",    19},
-                    {"restore", 1},
+                    {"restore", 2},
                     {"*load",   19},
 
                     {"load",    0},
@@ -459,39 +542,40 @@ TEST_F(AsceeExecutorTest, SimpleReentancy) {
             .wantCode = 200,
             .wantCalls = {
                     {"save",    0},
+                    {"save",    1},
                     {"load",    22},
 
-                    {"save",    1},
-                    {"load",    23},
                     {"save",    2},
+                    {"load",    23},
+                    {"save",    3},
                     {"load",    22},
                     {"load",    23},
-                    {"restore", 2},
+                    {"restore", 3},
                     {"*load",   23},
                     {"load",    22},
 
-                    {"save",    2},
-                    {"load",    23},
                     {"save",    3},
+                    {"load",    23},
+                    {"save",    4},
                     {"load",    22},
                     {"load",    23},
                     {"load",    22},
 
-                    {"save",    4},
-                    {"load",    23},
                     {"save",    5},
+                    {"load",    23},
+                    {"save",    6},
                     {"load",    22},
                     {"load",    23},
-                    {"restore", 5},
+                    {"restore", 6},
                     {"*load",   23},
                     {"load",    22},
 
-                    {"save",    5},
-                    {"load",    23},
                     {"save",    6},
+                    {"load",    23},
+                    {"save",    7},
                     {"load",    22},
                     {"load",    23},
-                    {"restore", 6},
+                    {"restore", 7},
                     {"*load",   23},
                     {"load",    22},
 
@@ -517,3 +601,35 @@ TEST_F(AsceeExecutorTest, SimpleDeferredCall) {
     };
     SUB_TEST("deferred", testCase);
 }
+
+TEST_F(AsceeExecutorTest, BatchExecution) {
+    asa::AppLoader loader("testdata/single-thread/call");
+    asa::AppIndex appIndex(&loader);
+    appIndex.prepareApps({123}, {toLongID(11)});
+
+    // AppRequest is not movable when a MockModifier is used.
+    vector<std::unique_ptr<AppRequest>> requests;
+    for (int i = 0; i < 3; ++i) {
+        requests.emplace_back(new AppRequest{
+                .id = i,
+                .calledAppID = toLongID(11),
+                .httpRequest = "request " + to_string(i),
+                .maxClocks = NORMAL_GAS,
+                .modifier = argennon::mocking::ascee::MockModifier(),
+                .appTable = appIndex.buildAppTable({toLongID(11)}),
+                .useControlledExecution = i % 2 == 0,
+                .signatureManager = VirtualSignatureManager({})
+        });
+    }
+    vector<AppRequest*> batch;
+    for (auto& req: requests) batch.emplace_back(req.get());
+
+    Executor executor;
+    auto responses = executor.executeBatch(batch);
+
+    ASSERT_EQ(responses.size(), 3);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(responses[i].statusCode, 200);
+        EXPECT_EQ(responses[i].httpResponse, "request " + to_string(i) + " is DONE!");
+    }
+}
@@ -40,3 +40,21 @@ TEST(AsceeVSigManagerTest, Simple) {
 }
 
 
+
+TEST(AsceeVSigManagerTest, Reset) {
+    VirtualSignatureManager signer({{1234, "signed by user"}});
+    auto sig = signer.sign("Hi all!", 12);
+
+    EXPECT_TRUE(signer.verifyAndInvalidate("signed by user", 1234, 0));
+    EXPECT_TRUE(signer.verify("Hi all!", 12, sig));
+
+    signer.reset();
+
+    EXPECT_TRUE(signer.verify("signed by user", 1234, 0));
+    EXPECT_FALSE(signer.verify("Hi all!", 12, sig));
+
+    sig = signer.sign("Bye!", 12);
+    EXPECT_EQ(sig, 1);
+    EXPECT_TRUE(signer.verify("Bye!", 12, sig));
+    EXPECT_FALSE(signer.verify("Hi all!", 12, sig));
+}
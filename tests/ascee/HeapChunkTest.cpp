@@ -17,6 +17,9 @@
 
 #include "subtest.h"
 #include <heap/Chunk.h>
+#include <heap/ChunkAllocator.h>
+#include <memory>
+#include <thread>
 
 using namespace argennon;
 using namespace ascee::runtime;
@@ -51,3 +54,133 @@ TEST(HeapChunkTest, ApplyDelta) {
     c.applyDelta(b, d4 + sizeof(d4));
     EXPECT_EQ("size: 15, capacity: 15, content: 0x[ 1 4 3 1 2 0 0 0 0 0 0 0 0 2 7 ]", (string) c);
 }
+
+TEST(HeapChunkTest, SlotReuse) {
+    EXPECT_EQ(ChunkAllocator::slotSize(0), 0);
+    EXPECT_EQ(ChunkAllocator::slotSize(1), 16);
+    EXPECT_EQ(ChunkAllocator::slotSize(16), 16);
+    EXPECT_EQ(ChunkAllocator::slotSize(17), 32);
+    EXPECT_EQ(ChunkAllocator::slotSize(100), 128);
+    EXPECT_EQ(ChunkAllocator::slotSize(Chunk::maxAllowedCapacity), Chunk::maxAllowedCapacity);
+
+    Chunk c(20);
+    c.setSize(20);
+    auto* content = c.getContentPointer(0, 1).get();
+    memset(content, 0xff, 20);
+
+    // the chunk grows in place inside its slot
+    c.reserveSpace(30);
+    EXPECT_EQ(c.getContentPointer(0, 1).get(), content);
+    EXPECT_EQ(*c.getContentPointer(25, 1).get(), 0);
+
+    // shrinking to a slightly smaller size does not reallocate, but the unused part is cleared
+    c.setSize(12);
+    c.shrinkSpace();
+    EXPECT_EQ(c.getContentPointer(0, 1).get(), content);
+    EXPECT_THROW(c.getContentPointer(12, 1), std::out_of_range);
+    c.reserveSpace(32);
+    EXPECT_EQ(*c.getContentPointer(11, 1).get(), 0xff);
+    EXPECT_EQ(*c.getContentPointer(12, 1).get(), 0);
+
+    c.reserveSpace(1000);
+    c.setSize(1000);
+    c.setSize(10);
+    c.shrinkSpace();
+    EXPECT_EQ((std::string) c, "size: 10, capacity: 10, content: 0x[ ff ff ff ff ff ff ff ff ff ff ]");
+    c.reserveSpace(16);
+    EXPECT_EQ(*c.getContentPointer(15, 1).get(), 0);
+}
+
+TEST(HeapChunkTest, CrossThreadSlots) {
+    // chunks are created by one thread and destroyed by another one, which moves slots between thread caches.
+    constexpr int count = 5000;
+    std::vector<std::unique_ptr<Chunk>> chunks(count);
+    std::thread producer([&] {
+        for (int i = 0; i < count; ++i) {
+            chunks[i] = std::make_unique<Chunk>(1 + i % 300);
+            chunks[i]->setSize(1 + i % 300);
+            *chunks[i]->getContentPointer(0, 1).get() = byte(i);
+        }
+    });
+    producer.join();
+
+    std::thread consumer([&] {
+        for (int i = 0; i < count; ++i) {
+            EXPECT_EQ(*chunks[i]->getContentPointer(0, 1).get(), byte(i));
+            chunks[i].reset();
+        }
+    });
+    consumer.join();
+
+    // slots of the exited threads are reused and new chunks are still zero initialized.
+    for (int i = 0; i < count; ++i) {
+        chunks[i] = std::make_unique<Chunk>(1 + i % 300);
+        chunks[i]->setSize(1 + i % 300);
+        EXPECT_EQ(*chunks[i]->getContentPointer(i % 300, 1).get(), 0);
+    }
+}
+
+TEST(HeapChunkTest, DeltaRoundTrip) {
+    // capacities of the chunks can be different.
+    auto contentOf = [](Chunk& c) {
+        auto* begin = c.getContentPointer(0, c.getsize()).get();
+        return std::vector<byte>(begin, begin + c.getsize());
+    };
+    Chunk source(200), replica;
+    source.setSize(150);
+    for (int i = 0; i < 150; ++i) *source.getContentPointer(i, 1).get() = byte(i);
+
+    std::vector<byte> delta;
+    source.writeDelta(delta, true);
+    const byte* reader = delta.data();
+    replica.applyDelta(reader, delta.data() + delta.size());
+    EXPECT_EQ(reader, delta.data() + delta.size());
+    EXPECT_EQ(contentOf(replica), contentOf(source));
+
+    *source.getContentPointer(3, 1).get() = 0xaa;
+    source.markModified(3, 4);
+    *source.getContentPointer(140, 1).get() = 0xbb;
+    source.markModified(140, 141);
+    delta.clear();
+    source.writeDelta(delta);
+    // only a few granules are included in the delta
+    EXPECT_LT(delta.size(), 30);
+    reader = delta.data();
+    replica.applyDelta(reader, delta.data() + delta.size());
+    EXPECT_EQ(contentOf(replica), contentOf(source));
+
+    // shrinking and expanding must clear the removed part in the replica
+    source.setSize(100);
+    source.setSize(180);
+    *source.getContentPointer(170, 1).get() = 0xcc;
+    source.markModified(170, 171);
+    delta.clear();
+    source.writeDelta(delta);
+    reader = delta.data();
+    replica.applyDelta(reader, delta.data() + delta.size());
+    EXPECT_EQ(contentOf(replica), contentOf(source));
+
+    // an unmodified chunk gives an empty delta
+    delta.clear();
+    source.writeDelta(delta);
+    EXPECT_EQ(delta, std::vector<byte>({0, 0}));
+}
+
+TEST(HeapChunkTest, SegmentedDigest) {
+    Chunk source(3000), replica(3000);
+    source.setSize(2100);
+    replica.setSize(2100);
+    EXPECT_EQ(source.calculateDigest(), replica.calculateDigest());
+
+    *source.getContentPointer(1500, 1).get() = 0xaa;
+    source.markModified(1500, 1501);
+    *replica.getContentPointer(1500, 1).get() = 0xaa;
+    replica.markModified(1500, 1501);
+    source.setSize(1000);
+    replica.setSize(1000);
+    source.setSize(2000);
+    // shrinking clears the modified byte, so only the size of the chunk matters.
+    Chunk empty(2000);
+    empty.setSize(2000);
+    EXPECT_EQ(source.calculateDigest(), empty.calculateDigest());
+}
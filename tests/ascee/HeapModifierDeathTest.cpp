@@ -18,7 +18,11 @@
 #include <gtest/gtest.h>
 #include <argc/types.h>
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
+#include <thread>
+#include <tuple>
 
 #include "heap/Chunk.h"
 #include "heap/RestrictedModifier.h"
@@ -45,7 +49,7 @@ protected:
 
 public:
     HeapModifierDeathTest() {
-        tempChunk1_10.setSize(120);
+        tempChunk1_10.setSize(160);
         tempChunk1_11.setSize(256);
         tempChunk1_100.setSize(256);
         tempChunk2_1.setSize(256);
@@ -265,6 +269,269 @@ TEST_F(HeapModifierDeathTest, RestoringMultiVersions) {
     EXPECT_EQ(modifier->load<int64>(120), 321);
 }
 
+TEST_F(HeapModifierDeathTest, PartialOverwrites) {
+    modifier->loadContext(1);
+    modifier->loadChunk(short_id(10));
+
+    modifier->saveVersion();
+    modifier->store<int32>(108, 1, 4);
+    modifier->addInt<int32>(150, 10);
+
+    auto v1 = modifier->saveVersion();
+    modifier->store<int32>(108, 2, 4);
+    modifier->store<int32>(108, 3, 8);
+    modifier->store<int32>(108, 4, 4);
+    modifier->addInt<int32>(150, 5);
+
+    EXPECT_EQ(modifier->load<int32>(108, 4), 4);
+    EXPECT_EQ(modifier->load<int32>(108, 8), 3);
+
+    // the number of a restored version is reused, and blocks which were not accessed after restoring must not keep
+    // the content of the discarded version.
+    modifier->restoreVersion(v1);
+    EXPECT_EQ(modifier->saveVersion(), v1);
+    EXPECT_EQ(modifier->load<int32>(108, 4), 1);
+    EXPECT_EQ(modifier->load<int32>(108, 8), 0);
+
+    modifier->writeToHeap();
+    EXPECT_EQ(*(int32*) tempChunk1_10.getContentPointer(108 + 4, 4).get(), 1);
+}
+
+TEST_F(HeapModifierDeathTest, ModifiedBlocks) {
+    modifier->loadContext(1);
+    modifier->loadChunk(short_id(11));
+    modifier->saveVersion();
+    modifier->store<int64>(120, 5);
+    auto v = modifier->saveVersion();
+    modifier->store<int64>(100, 7);
+    modifier->restoreVersion(v);
+
+    modifier->loadContext(2);
+    modifier->loadChunk(short_id(10));
+    modifier->store<int64>(100, 9);
+
+    vector<std::tuple<const Chunk*, uint32, uint32>> writes;
+    modifier->forEachHeapWrite([&](const Chunk* chunk, uint32 begin, uint32 end) {
+        writes.emplace_back(chunk, begin, end);
+    });
+    EXPECT_EQ(writes, (vector<std::tuple<const Chunk*, uint32, uint32>>{
+            {&tempChunk1_11, 120, 128},
+            {&tempChunk2_1,  100, 108}
+    }));
+
+    modifier->writeToHeap();
+    EXPECT_EQ(*(int64*) tempChunk1_11.getContentPointer(100, 8).get(), 789);
+    EXPECT_EQ(*(int64*) tempChunk1_11.getContentPointer(120, 8).get(), 5);
+    EXPECT_EQ(*(int64*) tempChunk2_1.getContentPointer(100, 8).get(), 9);
+}
+
+TEST_F(HeapModifierDeathTest, AccessTable) {
+    HeapModifier::AccessTable table(2, 2, 4);
+    table.addApp(1);
+    table.addChunk({0, 10}, &tempChunk1_10, SizeType::read_only, 0);
+    table.addBlock(-2, {0, Access::read_only, 0});
+    table.addBlock(100, {8, Access::writable, 0});
+    table.addBlock(108, {8, Access::writable, 0});
+    table.addApp(2);
+    table.addChunk({0, 11}, &tempChunk2_1, SizeType::read_only, 0);
+    table.addBlock(100, {8, Access::writable, 0});
+    EXPECT_THROW(table.addChunk({0, 12}, &tempChunk2_2, SizeType::read_only, 0), std::length_error);
+
+    HeapModifier m(std::move(table));
+    m.loadContext(1);
+    EXPECT_THROW(m.loadChunk(short_id(11)), std::out_of_range);
+    m.loadChunk(short_id(10));
+    m.saveVersion();
+
+    m.store<int64>(108, 2);
+    m.store<int64>(100, 1);
+    EXPECT_EQ(m.load<int64>(100), 1);
+    EXPECT_EQ(m.load<int64>(108), 2);
+    EXPECT_THROW(m.load<int64>(104), std::out_of_range);
+
+    m.loadContext(3);
+    EXPECT_THROW(m.load<int64>(100), std::out_of_range);
+
+    m.loadContext(2);
+    m.loadChunk(short_id(11));
+    EXPECT_EQ(m.load<int64>(100), 0);
+    EXPECT_THROW(m.load<int64>(108), std::out_of_range);
+}
+
+/// creates a modifier for app 1 which only has access to @p chunk, and loads the chunk.
+static std::unique_ptr<HeapModifier> singleChunkModifier(Chunk& chunk,
+                                                         const vector<std::pair<int32, AccessBlockInfo>>& blocks) {
+    HeapModifier::AccessTable table(1, 1, blocks.size());
+    table.addApp(1);
+    table.addChunk({0, 1}, &chunk, SizeType::read_only, 0);
+    for (const auto& [offset, info]: blocks) table.addBlock(offset, info);
+    auto m = std::make_unique<HeapModifier>(std::move(table));
+    m->loadContext(1);
+    m->loadChunk(short_id(1));
+    m->saveVersion();
+    return m;
+}
+
+/// runs @p request on several threads, and commits its modifications to @p chunk concurrently.
+template<typename F>
+static void commitConcurrently(Chunk& chunk, const vector<std::pair<int32, AccessBlockInfo>>& blocks, F request,
+                               int workers, int rounds) {
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; ++w) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < rounds; ++i) {
+                auto m = singleChunkModifier(chunk, blocks);
+                request(*m);
+                m->writeToHeap();
+            }
+        });
+    }
+    for (auto& t: threads) t.join();
+}
+
+static float64 loadFloat(Chunk& chunk, int32 offset) {
+    float64 result;
+    memcpy(&result, chunk.getContentPointer(offset, 8).get(), 8);
+    return result;
+}
+
+static void storeFloat(Chunk& chunk, int32 offset, float64 value) {
+    memcpy(chunk.getContentPointer(offset, 8).get(), &value, 8);
+}
+
+TEST_F(HeapModifierDeathTest, ConcurrentAdditiveCommit) {
+    Chunk chunk(64);
+    chunk.setSize(64);
+    *(int64*) chunk.getContentPointer(8, 8).get() = 1000;
+
+    constexpr int workers = 8, rounds = 200;
+    // an unaligned block is committed using the chunk mutex.
+    commitConcurrently(chunk, {{1,  {2, Access::int_additive, 0}},
+                               {8,  {8, Access::int_additive, 0}},
+                               {20, {4, Access::int_additive, 0}}}, [](HeapModifier& m) {
+        m.addInt<int16>(1, 1);
+        m.addInt<int64>(8, -1);
+        m.addInt<int32>(20, 3);
+    }, workers, rounds);
+
+    EXPECT_EQ(*(int16*) chunk.getContentPointer(1, 2).get(), workers * rounds);
+    EXPECT_EQ(*(int64*) chunk.getContentPointer(8, 8).get(), 1000 - workers * rounds);
+    EXPECT_EQ(*(int32*) chunk.getContentPointer(20, 4).get(), 3 * workers * rounds);
+}
+
+TEST_F(HeapModifierDeathTest, FloatAdditive) {
+    Chunk chunk(64);
+    chunk.setSize(64);
+    storeFloat(chunk, 8, 2.5);
+
+    constexpr int workers = 8, rounds = 200;
+    // an unaligned block is committed using the chunk mutex.
+    commitConcurrently(chunk, {{0,  {4, Access::writable, 0}},
+                               {8,  {8, Access::float_additive, 0}},
+                               {17, {8, Access::float_additive, 0}}}, [](HeapModifier& m) {
+        m.addFloat(8, 0.125);
+        m.addFloat(8, -0x1p-16);
+        m.addFloat(17, 3 * 0x1p-16);
+        EXPECT_THROW(m.addFloat(17, 0.1), std::out_of_range);
+        EXPECT_THROW(m.addFloat(17, 0x1p37), std::out_of_range);
+        EXPECT_THROW(m.addFloat(17, NAN), std::out_of_range);
+        EXPECT_THROW(m.addFloat(0, 1), std::out_of_range);
+        EXPECT_THROW(m.addInt<int64>(8, 1), std::out_of_range);
+    }, workers, rounds);
+
+    // values are on the grid, so the result is exact.
+    EXPECT_EQ(loadFloat(chunk, 8), 2.5 + workers * rounds * (0.125 - 0x1p-16));
+    EXPECT_EQ(loadFloat(chunk, 17), workers * rounds * 3 * 0x1p-16);
+
+    // the sum of the values added by a request wraps around.
+    auto m = singleChunkModifier(chunk, {{8, {8, Access::float_additive, 0}}});
+    m->addFloat(8, 0x1p36);
+    m->addFloat(8, 0x1p36 + 0.5);
+    m->writeToHeap();
+    EXPECT_EQ(loadFloat(chunk, 8), -0x1p37 + 0.5 + 2.5 + workers * rounds * (0.125 - 0x1p-16));
+
+    EXPECT_THROW(singleChunkModifier(chunk, {{0, {4, Access::float_additive, 0}}}), BlockError);
+
+    // a block which does not fit in the chunk is not written.
+    chunk.setSize(20);
+    auto truncated = loadFloat(chunk, 17);
+    m = singleChunkModifier(chunk, {{17, {8, Access::float_additive, 0}}});
+    m->addFloat(17, 1);
+    m->writeToHeap();
+    EXPECT_EQ(loadFloat(chunk, 17), truncated);
+}
+
+TEST_F(HeapModifierDeathTest, InvalidFloatInHeap) {
+    Chunk chunk(64);
+    chunk.setSize(64);
+    const vector<std::pair<int32, AccessBlockInfo>> blocks{{8,  {8, Access::float_additive, 0}},
+                                                           {17, {8, Access::float_additive, 0}}};
+
+    struct {
+        float64 stored, added, want;
+    } testCases[] = {
+            // values off the grid are truncated.
+            {.stored = 0.1, .added = 1, .want = 1 + 6553 * 0x1p-16},
+            {.stored = -3 * 0x1p-17, .added = 0x1p-16, .want = 0},
+            // values out of range wrap around.
+            {.stored = 0x1p37, .added = -1, .want = 0x1p37 - 1},
+            {.stored = -0x1p40 - 2, .added = 1, .want = -1},
+            {.stored = INFINITY, .added = 1, .want = 1},
+            {.stored = NAN, .added = -1, .want = -1},
+            // the stored value is valid, but the result is out of range.
+            {.stored = 0x1p37 - 1, .added = 1, .want = -0x1p37},
+            {.stored = -0x1p37, .added = -0x1p-16, .want = 0x1p37 - 0x1p-16},
+    };
+
+    // both the atomic path and the mutex path are checked.
+    for (int32 offset: {8, 17}) {
+        for (const auto& testCase: testCases) {
+            storeFloat(chunk, offset, testCase.stored);
+            auto m = singleChunkModifier(chunk, blocks);
+            m->addFloat(offset, testCase.added);
+            EXPECT_NO_THROW(m->writeToHeap());
+            EXPECT_EQ(loadFloat(chunk, offset), testCase.want) << "stored: " << testCase.stored;
+        }
+    }
+}
+
+TEST_F(HeapModifierDeathTest, FloatCommitOrder) {
+    struct {
+        float64 stored;
+        vector<float64> deltas;
+        float64 want;
+    } testCases[] = {
+            {
+                    .stored = -1024 - 0x1p-15,
+                    .deltas = {0x1p36 - 0x1p-16, -0x1p35, 3 * 0x1p-16, 12345.5, -0.75, 0x1p-16},
+                    .want = -1024 - 0x1p-15 + 0x1p36 - 0x1p35 + 12345.5 - 0.75 + 3 * 0x1p-16,
+            },
+            // partial sums go out of range in some orders.
+            {.stored = 0x1p37 - 2, .deltas = {1, 1, -2}, .want = 0x1p37 - 2},
+            {.stored = -0x1p37 + 1, .deltas = {0x1p36, -0x1p36, -1, -0x1p36, 0.5}, .want = 0x1p37 - 0x1p36 + 0.5},
+    };
+
+    // every commit order must give the same bits.
+    for (const auto& testCase: testCases) {
+        vector<int> order(testCase.deltas.size());
+        for (int i = 0; i < int(order.size()); ++i) order[i] = i;
+        do {
+            for (int32 offset: {8, 17}) {
+                Chunk chunk(64);
+                chunk.setSize(64);
+                storeFloat(chunk, offset, testCase.stored);
+                vector<std::unique_ptr<HeapModifier>> requests;
+                for (auto delta: testCase.deltas) {
+                    requests.emplace_back(singleChunkModifier(chunk, {{offset, {8, Access::float_additive, 0}}}));
+                    requests.back()->addFloat(offset, delta);
+                }
+                for (int i: order) requests[i]->writeToHeap();
+                EXPECT_EQ(loadFloat(chunk, offset), testCase.want);
+            }
+        } while (std::next_permutation(order.begin(), order.end()));
+    }
+}
+
 TEST_F(HeapModifierDeathTest, ChunkExpansion) {
     Chunk tempChunk;
     tempChunk.reserveSpace(15);
@@ -0,0 +1,50 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "subtest.h"
+#include "ascee/executor/ResponseSlab.h"
+
+using namespace argennon;
+using namespace ascee::runtime;
+
+TEST(AsceeResponseSlab, ZeroCapacity) {
+    EXPECT_THROW(ResponseSlab slab(0), std::invalid_argument);
+    ResponseSlab slab(1);
+    EXPECT_EQ(slab.store(""), "");
+    EXPECT_EQ(slab.store("a"), "a");
+    EXPECT_THROW(slab.store("b"), std::length_error);
+    EXPECT_EQ(slab.getContent(), "a");
+}
+
+TEST(AsceeResponseSlab, RejectedStore) {
+    ResponseSlab slab(8);
+    EXPECT_EQ(slab.store("12345"), "12345");
+    // rejected responses must not consume any space of the slab.
+    for (int i = 0; i < 100; ++i) EXPECT_THROW(slab.store("6789"), std::length_error);
+    EXPECT_EQ(slab.store("678"), "678");
+    EXPECT_EQ(slab.getContent(), "12345678");
+}
+
+TEST(AsceeResponseSlab, Reset) {
+    ResponseSlab slab(8);
+    EXPECT_EQ(slab.store("12345678"), "12345678");
+    EXPECT_THROW(slab.store("9"), std::length_error);
+    slab.reset();
+    EXPECT_EQ(slab.getContent(), "");
+    EXPECT_EQ(slab.store("abcdefgh"), "abcdefgh");
+    EXPECT_EQ(slab.getContent(), "abcdefgh");
+}
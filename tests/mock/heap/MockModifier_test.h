@@ -49,6 +49,9 @@ public:
     inline
     void addInt(uint32 offset, T value) {}
 
+    inline
+    void addFloat(uint32 offset, float64 value) {}
+
     template<typename T, int h>
     inline
     int storeVarUInt(const util::PrefixTrie <T, h>& trie, uint32 offset, T value) {
@@ -65,6 +68,7 @@ public:
     MOCK_METHOD(void, loadChunk, (long_id chunkID));
     MOCK_METHOD(void, loadContext, (long_id appID));
     MOCK_METHOD(void, writeToHeap, ());
+    MOCK_METHOD(void, reset, ());
     MOCK_METHOD(void, restoreVersion, (int16_t version));
     MOCK_METHOD(int16_t, saveVersion, ());
     MOCK_METHOD(void, updateChunkSize, (uint32 newSize));
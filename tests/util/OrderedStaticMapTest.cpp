@@ -17,6 +17,7 @@
 
 
 #include "subtest.h"
+#include "core/primitives.h"
 #include "util/OrderedStaticMap.hpp"
 
 using namespace argennon;
@@ -86,6 +87,29 @@ TEST(OrderedStaticMapTest, MergeParallel) {
     EXPECT_EQ(m.getKeys(), vector<int>({1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2}));
 }
 
+TEST(OrderedStaticMapTest, Search) {
+    for (int n = 0; n <= 40; ++n) {
+        vector<int> keys, values;
+        for (int i = 0; i < n; ++i) {
+            keys.push_back(3 * i + 1);
+            values.push_back(i);
+        }
+        OrderedStaticMap<int, int> m(keys, values);
+        for (int i = 0; i < n; ++i) {
+            EXPECT_EQ(m.indexOf(3 * i + 1), i);
+            EXPECT_EQ(m.at(3 * i + 1), i);
+            EXPECT_EQ(m.indexOf(3 * i), -1);
+            EXPECT_EQ(m.indexOf(3 * i + 2), -1);
+        }
+        EXPECT_EQ(m.indexOf(3 * n + 1), -1);
+        EXPECT_THROW(m.at(-1), std::out_of_range);
+    }
+
+    OrderedStaticMap<long_long_id, int> compound({{1, 5}, {2, 0}, {2, 7}}, {15, 20, 27});
+    EXPECT_EQ(compound.at({2, 7}), 27);
+    EXPECT_EQ(compound.indexOf({2, 6}), -1);
+}
+
 TEST(OrderedStaticMapTest, SimpleAccessingBenchmark) {
     OrderedStaticMap<int, float> singleStatic({8}, {0.0});
     std::unordered_map<int, float> singleStd = {{8, 0.0}};
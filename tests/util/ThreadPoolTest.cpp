@@ -0,0 +1,57 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "subtest.h"
+#include "util/ThreadPool.hpp"
+
+using namespace argennon;
+using namespace util;
+using std::vector;
+
+
+TEST(UtilThreadPool, ParallelFor) {
+    ThreadPool pool(3);
+    EXPECT_EQ(pool.size(), 3);
+
+    for (int64_t grain: {1, 7, 1000}) {
+        vector<std::atomic<int>> calls(1000);
+        pool.parallelFor(1000, [&](int64_t i) { calls[i]++; }, grain);
+        for (int i = 0; i < 1000; ++i) ASSERT_EQ(calls[i], 1) << "index: " << i << " grain: " << grain;
+    }
+
+    pool.parallelFor(0, [](int64_t) { FAIL(); });
+
+    std::atomic<int> count = 0;
+    EXPECT_THROW(pool.parallelFor(100, [&](int64_t i) {
+        ++count;
+        if (i == 10) throw std::runtime_error("failed");
+    }), std::runtime_error);
+    EXPECT_LE(count, 100);
+}
+
+TEST(UtilThreadPool, NestedForkJoin) {
+    // nested jobs must not deadlock, even when they are more than the threads of the pool.
+    ThreadPool pool(2);
+    std::function<int64_t(int64_t, int64_t)> sum = [&](int64_t begin, int64_t end) -> int64_t {
+        if (end - begin == 1) return begin;
+        int64_t left, right;
+        pool.forkJoin([&] { left = sum(begin, (begin + end) / 2); },
+                      [&] { right = sum((begin + end) / 2, end); });
+        return left + right;
+    };
+    EXPECT_EQ(sum(0, 1000), 999 * 1000 / 2);
+}
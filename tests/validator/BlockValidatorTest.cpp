@@ -0,0 +1,115 @@
+// Copyright (c) 2021-2022 aybehrouz <behrouz_ayati@yahoo.com>. All rights
+// reserved. This file is part of the C++ implementation of the Argennon smart
+// contract Execution Environment (AscEE).
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <mutex>
+#include "storage/PageLoader.h"
+#include "storage/PageCache.h"
+#include "validator/BlockValidator.h"
+
+using namespace argennon;
+using namespace ave;
+using namespace asa;
+using std::vector;
+
+/// a loader of a chain of blocks. Block n of the chain has the block number n + 1, and every block has one request.
+class ChainLoader : public BlockLoader {
+public:
+    struct Block {
+        vector<VarLenFullID> readonlyPages;
+        vector<VarLenFullID> writablePages;
+        Digest responseDigest{};
+    };
+
+    explicit ChainLoader(vector<Block> chain) : chain(std::move(chain)) {}
+
+    void setCurrentBlock(const BlockInfo& b) override {
+        current = b.blockNumber - 1;
+        std::lock_guard<std::mutex> lock(mutex);
+        loadedBlocks.emplace_back(b.blockNumber);
+    }
+
+    vector<RequestStream> createRequestStreams(int count) override {
+        vector<RequestStream> streams;
+        // the called app does not exist, so in controlled execution the request only fails.
+        streams.emplace_back(vector<AppRequestInfo>{{.id = 0, .useControlledExecution = true}});
+        return streams;
+    }
+
+    int32_fast getNumOfRequests() override { return 1; }
+
+    vector<VarLenFullID> getReadonlyPageList() override { return chain.at(current).readonlyPages; }
+
+    vector<VarLenFullID> getWritablePageList() override { return chain.at(current).writablePages; }
+
+    Digest getResponseListDigest() override { return chain.at(current).responseDigest; }
+
+    vector<int_fast64_t> getLoadedBlocks() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return loadedBlocks;
+    }
+
+private:
+    vector<Block> chain;
+    int_fast64_t current = 0;
+    std::mutex mutex;
+    vector<int_fast64_t> loadedBlocks;
+};
+
+static VarLenFullID pageID(byte n) {
+    return VarLenFullID(std::unique_ptr<byte[]>(new byte[4]{0x10, 0x44, n, 0}));
+}
+
+static vector<BlockInfo> blockInfos(int count) {
+    vector<BlockInfo> result;
+    for (int i = 1; i <= count; ++i) result.push_back({i});
+    return result;
+}
+
+TEST(BlockValidatorTest, ValidChain) {
+    // every block reads the pages written by its previous block, so those pages are fetched after the previous
+    // block is committed.
+    ChainLoader loader({
+                               {.readonlyPages = {pageID(1)}, .writablePages = {pageID(2)}},
+                               {.readonlyPages = {pageID(2)}, .writablePages = {pageID(3)}},
+                               {.readonlyPages = {pageID(1), pageID(2)}, .writablePages = {pageID(3)}},
+                               {.readonlyPages = {pageID(3)}, .writablePages = {pageID(2), pageID(4)}},
+                       });
+    PageLoader pageLoader;
+    PageCache cache(pageLoader);
+    BlockValidator validator(cache, loader, 4);
+
+    EXPECT_EQ(validator.validateChain(blockInfos(4), {0}), 4);
+    EXPECT_EQ(loader.getLoadedBlocks(), vector<int_fast64_t>({1, 2, 3, 4}));
+}
+
+TEST(BlockValidatorTest, InvalidBlockInChain) {
+    ChainLoader loader({
+                               {.writablePages = {pageID(1)}},
+                               {.readonlyPages = {pageID(1)}, .writablePages = {pageID(2)}, .responseDigest = {1}},
+                               {.readonlyPages = {pageID(2)}},
+                       });
+    PageLoader pageLoader;
+    PageCache cache(pageLoader);
+    BlockValidator validator(cache, loader, 2);
+
+    // the third block is prepared while the invalid block is executed, but it is discarded.
+    EXPECT_EQ(validator.validateChain(blockInfos(3), {0}), 1);
+    EXPECT_EQ(loader.getLoadedBlocks(), vector<int_fast64_t>({1, 2, 3}));
+
+    EXPECT_EQ(validator.validateChain({}, {0}), 0);
+}
@@ -67,10 +67,18 @@ class FakeExecutor {
 public:
     static inline MockExecutor* mock;
 
+    explicit FakeExecutor(ResponseSlab&) {}
+
     AppResponse executeOne(AppRequest* req) const {
         std::cout << "->" << req->id;
         return mock->executeOne(req->id);
     }
+
+    std::vector<AppResponse> executeBatch(std::span<AppRequest* const> requests) const {
+        std::vector<AppResponse> responses;
+        for (auto* req: requests) responses.emplace_back(executeOne(req));
+        return responses;
+    }
 };
 
 class FakeStream {
@@ -262,3 +270,212 @@ TEST_F(RequestProcessorTest, SimpleDependencyGraph) {
 
     rp.checkDependencyGraph();
 }
+
+/// every request increments a counter stored at the start of chunk1, so every pair of requests conflicts.
+class CounterExecutor {
+public:
+    explicit CounterExecutor(ResponseSlab& slab) : slab(slab) {}
+
+    AppResponse executeSpeculatively(AppRequest* req) const {
+        auto& modifier = req->modifier;
+        modifier.saveVersion();
+        modifier.loadContext(app_1_id);
+        modifier.loadChunk(long_id(0x4400000000000000), long_id(0x0500000000000000));
+        auto counter = modifier.load<int32>(0);
+        std::this_thread::yield();
+        modifier.store<int32>(0, counter + 1);
+        return {200, slab.store(std::to_string(counter))};
+    }
+
+private:
+    ResponseSlab& slab;
+};
+
+TEST_F(RequestProcessorTest, SpeculativeExecution) {
+    constexpr int requests_count = 64;
+    for (int workers = 1; workers < max_workers_count; workers += 5) {
+        Page page(123);
+        ChunkIndex index({},
+                         {{{app_1_id, chunk1_local_id}, &page}},
+                         {{{app_1_id, chunk1_local_id}},
+                          {{8,        0}}},
+                         1);
+        index.getChunk({app_1_id, chunk1_local_id})->setSize(8);
+
+        std::vector<AppRequestInfo> requests;
+        for (int i = 0; i < requests_count; ++i) {
+            requests.emplace_back(AppRequestInfo{
+                    .id = i,
+                    .memoryAccessMap = {
+                            {app_1_id},
+                            {{{chunk1_local_id}, {{{0}, {{4, Access::writable, i}}},}}}},
+            });
+        }
+        RequestProcessor rp(index, appIndex, requests_count, workers);
+        rp.loadRequests<FakeStream>({{0, requests_count, requests}});
+
+        auto responses = rp.speculativeExecuteRequests<CounterExecutor>();
+
+        // the result must be the same as executing the requests in the order of their ids.
+        for (int i = 0; i < requests_count; ++i) {
+            EXPECT_EQ(responses[i].httpResponse, std::to_string(i));
+        }
+        int32 counter;
+        memcpy(&counter, index.getChunk({app_1_id, chunk1_local_id})->getContentPointer(0, 4).get(), 4);
+        EXPECT_EQ(counter, requests_count);
+        EXPECT_GE(rp.getAbortRate(), 0);
+        EXPECT_LT(rp.getAbortRate(), 1);
+    }
+}
+
+/// every request sums the chunk. Every third request appends a cell to the chunk, and the others increment a cell.
+class GrowingExecutor {
+public:
+    explicit GrowingExecutor(ResponseSlab& slab) : slab(slab) {}
+
+    AppResponse executeSpeculatively(AppRequest* req) const {
+        auto& modifier = req->modifier;
+        modifier.saveVersion();
+        modifier.loadContext(app_1_id);
+        modifier.loadChunk(long_id(0x4400000000000000), long_id(0x0500000000000000));
+        auto size = modifier.getChunkSize();
+        int64 sum = 0;
+        for (uint32 offset = 0; offset < size; offset += 4) {
+            sum += modifier.load<int32>(offset);
+            std::this_thread::yield();
+        }
+        if (req->id % 3 == 0) {
+            modifier.updateChunkSize(size + 4);
+            modifier.store<int32>(size, int32(req->id + 1));
+        } else {
+            auto offset = uint32(req->id % (size / 4)) * 4;
+            modifier.store<int32>(offset, modifier.load<int32>(offset) + 1);
+        }
+        return {200, slab.store(std::to_string(size) + ":" + std::to_string(sum))};
+    }
+
+private:
+    ResponseSlab& slab;
+};
+
+TEST_F(RequestProcessorTest, SpeculativeChunkGrowth) {
+    constexpr int requests_count = 48;
+    constexpr int32 max_size = 4 + 4 * ((requests_count + 2) / 3);
+
+    // the expected results are calculated by executing the requests serially.
+    std::vector<int32> cells{7};
+    std::vector<std::string> expected;
+    for (int i = 0; i < requests_count; ++i) {
+        int64 sum = 0;
+        for (auto cell: cells) sum += cell;
+        expected.emplace_back(std::to_string(cells.size() * 4) + ":" + std::to_string(sum));
+        if (i % 3 == 0) cells.push_back(i + 1);
+        else ++cells[i % cells.size()];
+    }
+
+    for (int workers = 1; workers < max_workers_count; workers += 5) {
+        Page page(123);
+        ChunkIndex index({},
+                         {{{app_1_id, chunk1_local_id}, &page}},
+                         {{{app_1_id, chunk1_local_id}},
+                          {{max_size, 0}}},
+                         1);
+        auto* chunk = index.getChunk({app_1_id, chunk1_local_id});
+        chunk->setSize(4);
+        int32 initial = 7;
+        memcpy(chunk->getContentPointer(0, 4).get(), &initial, 4);
+
+        std::vector<AppRequestInfo> requests;
+        for (int i = 0; i < requests_count; ++i) {
+            std::vector<int32> offsets;
+            std::vector<AccessBlockInfo> blocks;
+            if (i % 3 == 0) {
+                offsets.push_back(-1);
+                blocks.push_back({max_size, Access::writable, i});
+            } else {
+                offsets.push_back(-2);
+                blocks.push_back({0, Access::read_only, i});
+            }
+            for (int32 offset = 0; offset < max_size; offset += 4) {
+                offsets.push_back(offset);
+                blocks.push_back({4, Access::writable, i});
+            }
+            requests.emplace_back(AppRequestInfo{
+                    .id = i,
+                    .memoryAccessMap = {{app_1_id}, {{{chunk1_local_id}, {{offsets, blocks}}}}},
+            });
+        }
+        RequestProcessor rp(index, appIndex, requests_count, workers);
+        rp.loadRequests<FakeStream>({{0, requests_count, requests}});
+
+        auto responses = rp.speculativeExecuteRequests<GrowingExecutor>();
+
+        for (int i = 0; i < requests_count; ++i) {
+            EXPECT_EQ(responses[i].httpResponse, expected[i]) << "request: " << i;
+        }
+        ASSERT_EQ(chunk->getsize(), cells.size() * 4);
+        for (int i = 0; i < cells.size(); ++i) {
+            int32 cell;
+            memcpy(&cell, chunk->getContentPointer(i * 4, 4).get(), 4);
+            EXPECT_EQ(cell, cells[i]) << "cell: " << i;
+        }
+        EXPECT_LT(rp.getAbortRate(), 1);
+    }
+}
+
+TEST_F(RequestProcessorTest, InvalidFloatAddition) {
+    constexpr long_id invalid_app(0x1900000000000000), valid_app(0x1a00000000000000);
+    constexpr long_long_id local_chunk(0, 0x100000000000000);
+    AppLoader floatLoader{"testdata/single-thread/float-add"};
+    AppIndex floatApps{&floatLoader};
+    floatApps.prepareApps({123}, {invalid_app, valid_app});
+
+    for (int workers = 1; workers < max_workers_count; workers += 5) {
+        Page invalidPage(123), validPage(123);
+        ChunkIndex index({},
+                         {{{invalid_app, local_chunk}, &invalidPage},
+                          {{valid_app,   local_chunk}, &validPage}},
+                         {{{invalid_app, local_chunk}, {valid_app, local_chunk}},
+                          {{16,          0},           {16,        0}}},
+                         2);
+        for (auto app: {invalid_app, valid_app}) {
+            auto* chunk = index.getChunk({app, local_chunk});
+            chunk->setSize(16);
+            // a value which is not on the grid is truncated when it is committed.
+            float64 stored = 0.1;
+            memcpy(chunk->getContentPointer(8, 8).get(), &stored, 8);
+        }
+
+        std::vector<AppRequestInfo> requests;
+        for (int i = 0; i < 4; ++i) {
+            auto app = i % 2 == 0 ? invalid_app : valid_app;
+            requests.emplace_back(AppRequestInfo{
+                    .id = i,
+                    .calledAppID = app,
+                    .maxClocks = 1000,
+                    .appAccessList = {app},
+                    .useControlledExecution = true,
+                    .memoryAccessMap = {
+                            {app},
+                            {{{local_chunk}, {{{0, 8}, {{8, Access::float_additive, i},
+                                                        {8, Access::float_additive, i}}}}}}},
+            });
+        }
+        RequestProcessor rp(index, floatApps, int(requests.size()), workers);
+        rp.loadRequests<FakeStream>({{0, int(requests.size()), requests}});
+
+        // an invalid value fails the request, not the whole block.
+        auto responses = rp.parallelExecuteRequests<Executor>();
+        for (int i = 0; i < requests.size(); ++i) {
+            EXPECT_EQ(responses[i].statusCode, i % 2 == 0 ? int(ascee::StatusCode::out_of_range) : 200) << "request: " << i;
+        }
+
+        float64 result[2];
+        memcpy(result, index.getChunk({invalid_app, local_chunk})->getContentPointer(0, 16).get(), 16);
+        EXPECT_EQ(result[0], 0);
+        EXPECT_EQ(result[1], 0.1);
+        memcpy(result, index.getChunk({valid_app, local_chunk})->getContentPointer(0, 16).get(), 16);
+        EXPECT_EQ(result[0], 1);
+        EXPECT_EQ(result[1], 1 + 6553 * 0x1p-16);
+    }
+}
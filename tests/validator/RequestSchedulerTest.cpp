@@ -459,6 +459,7 @@ TEST_F(RequestSchedulerTest, CollisionsFromRequests) {
                                  .adjList = {11}});
 
 
+    scheduler.buildAdjacency();
     auto sortedMap = scheduler.sortAccessBlocks(8);
 
     scheduler.checkCollisions({app_1_id, chunk1_local_id},
@@ -532,6 +533,7 @@ TEST_F(RequestSchedulerTest, AdditiveCollisions) {
                                  }}}},
                                  .adjList = {}});
 
+    scheduler.buildAdjacency();
     auto sortedMap = scheduler.sortAccessBlocks(4);
 
     scheduler.checkCollisions({app_1_id, chunk1_local_id},
@@ -580,6 +582,7 @@ TEST_F(RequestSchedulerTest, WritersCollisions) {
                                  }}}},
                                  .adjList = {}});
 
+    scheduler.buildAdjacency();
     auto sortedMap = scheduler.sortAccessBlocks(2);
 
 
@@ -644,6 +647,7 @@ TEST_F(RequestSchedulerTest, SimpleDagFull) {
                     .adjList = {}
             });
 
+    scheduler.buildAdjacency();
     auto sortedMap = scheduler.sortAccessBlocks(8);
 
     scheduler.checkCollisions({app_1_id, chunk1_local_id}, sortedMap.at(app_1_id).at(chunk1_local_id).getKeys(),
@@ -686,6 +690,7 @@ TEST_F(RequestSchedulerTest, ExecutionDag) {
         }
 
         void test() {
+            scheduler.buildAdjacency();
             for (int i = 0; i < n; ++i) {
                 scheduler.finalizeRequest(i);
             }
@@ -755,7 +760,8 @@ TEST_F(RequestSchedulerTest, ExecutionDag) {
                          {.id = 2, .adjList = {}},
                          {.id = 1, .adjList = {2}},
                  },
-                 {0, 1, 2}
+                 // 1 is on the longest path, so it has a higher priority.
+                 {1, 0, 2}
     );
     SUB_TEST("Two source nodes", t4);
 
@@ -777,9 +783,31 @@ TEST_F(RequestSchedulerTest, ExecutionDag) {
                          {.id = 2, .adjList ={}},
                          {.id = 1, .adjList ={}},
                  },
-                 {0, 3, 2, 1}
+                 // successors with the same priority are released in the order of their ids.
+                 {0, 3, 1, 2}
     );
     SUB_TEST("Wrong source nodes", t6);
+
+    //      2 --> 3 --> 4
+    //    /
+    //  0 --> 5
+    //
+    //  1 --> 6 --> 7
+    DagTester t7(8, singleChunk,
+                 {
+                         {.id = 0, .adjList = {2, 5}},
+                         {.id = 1, .adjList = {6}},
+                         {.id = 2, .adjList = {3}},
+                         {.id = 3, .adjList = {4}},
+                         {.id = 4, .adjList = {}},
+                         {.id = 5, .adjList = {}},
+                         {.id = 6, .adjList = {7}},
+                         {.id = 7, .adjList = {}},
+                 },
+                 // 5 is released before 6, but 6 has a higher priority.
+                 {0, 1, 2, 3, 6, 4, 5, 7}
+    );
+    SUB_TEST("Later released successors", t7);
 }
 
 /*